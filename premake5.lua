@@ -1,5 +1,34 @@
+-- Sources shared by bsbar and bsbar_bench
+local bsbar_files = {
+	"src/Battery.cpp",
+	"src/Block.cpp",
+	"src/Cache.cpp",
+	"src/Clock.cpp",
+	"src/ColorRamp.cpp",
+	"src/Common.cpp",
+	"src/Config.cpp",
+	"src/Control.cpp",
+	"src/Cpu.cpp",
+	"src/Custom.cpp",
+	"src/DateTime.cpp",
+	"src/Disk.cpp",
+	"src/Histogram.cpp",
+	"src/History.cpp",
+	"src/I3bar.cpp",
+	"src/Load.cpp",
+	"src/Meminfo.cpp",
+	"src/Memory.cpp",
+	"src/Menu.cpp",
+	"src/Network.cpp",
+	"src/Power.cpp",
+	"src/PulseAudio.cpp",
+	"src/Published.cpp",
+	"src/Sampler.cpp",
+	"src/Temperature.cpp",
+}
+
 workspace "bsbar"
-    configurations { "Debug", "Release" }
+    configurations { "Debug", "Release", "TSan", "Profile" }
 
 project "bsbar"
     kind "ConsoleApp"
@@ -7,18 +36,9 @@ project "bsbar"
 	cppdialect "C++20"
     targetdir "bin/%{cfg.buildcfg}"
 
+    files(bsbar_files)
     files {
-		"src/Battery.cpp",
-		"src/Block.cpp",
-		"src/Common.cpp",
-		"src/Config.cpp",
-		"src/Custom.cpp",
-		"src/DateTime.cpp",
         "src/main.cpp",
-		"src/Menu.cpp",
-		"src/Network.cpp",
-		"src/PulseAudio.cpp",
-		"src/Temperature.cpp",
     }
 
     includedirs {
@@ -34,4 +54,51 @@ project "bsbar"
         symbols "On"
 
     filter "configurations:Release"
-        optimize "On"
\ No newline at end of file
+        optimize "On"
+
+    filter "configurations:TSan"
+        symbols "On"
+        optimize "On"
+        buildoptions { "-fsanitize=thread" }
+        linkoptions { "-fsanitize=thread" }
+
+    -- Release build whose --simulate report also counts allocations
+    filter "configurations:Profile"
+        symbols "On"
+        optimize "On"
+        defines { "BSBAR_COUNT_ALLOCATIONS" }
+        files { "src/bench/Allocations.cpp" }
+
+-- Microbenchmarks of hot paths, writes results as JSON (see src/bench/Bench.h)
+project "bsbar_bench"
+    kind "ConsoleApp"
+    language "C++"
+	cppdialect "C++20"
+    targetdir "bin/%{cfg.buildcfg}"
+
+    files(bsbar_files)
+    files {
+        "src/bench/Bench.cpp",
+        "src/bench/main.cpp",
+    }
+
+    includedirs {
+		"src",
+		"vendor",
+	}
+
+	links {
+		"pulse"
+	}
+
+    filter "configurations:Debug"  
+        symbols "On"
+
+    filter "configurations:Release"
+        optimize "On"
+
+    filter "configurations:TSan"
+        symbols "On"
+        optimize "On"
+        buildoptions { "-fsanitize=thread" }
+        linkoptions { "-fsanitize=thread" }
\ No newline at end of file
@@ -33,6 +33,11 @@ namespace bsbar
 		return false;
 	}
 
+	void BatteryBlock::custom_config_done()
+	{
+		m_battery_path = system_path(m_battery_path);
+	}
+
 	static std::unordered_map<std::string, std::string> update_battery_info(const std::string& path)
 	{
 		std::ifstream file(path);
@@ -8,6 +8,8 @@ namespace bsbar
 	class BatteryBlock : public Block
 	{
 	public:
+		virtual void custom_config_done() override;
+
 		virtual bool add_custom_config(std::string_view key, toml::node& value) override;
 		virtual bool custom_update(time_point) override;
 
@@ -3,13 +3,18 @@
 #include "Common.h"
 
 #include "Battery.h"
+#include "Cpu.h"
 #include "Custom.h"
 #include "DateTime.h"
+#include "Disk.h"
+#include "Load.h"
+#include "Memory.h"
 #include "Menu.h"
 #include "Network.h"
 #include "PulseAudio.h"
 #include "Temperature.h"
 
+#include <cmath>
 #include <csignal>
 #include <fcntl.h>
 #include <iomanip>
@@ -58,6 +63,20 @@ namespace bsbar
 
 	static std::unordered_map<int, Block*> s_signals;
 
+	static std::atomic<bool>		s_paused = false;
+	static std::mutex				s_pause_mutex;
+	static std::condition_variable	s_pause_cv;
+
+	// Set from the active power profile, see set_power_profile()
+	static std::atomic<double>		s_interval_scale	= 1.0;
+	static std::atomic<int64_t>		s_align_ms			= 0;
+	static std::atomic<bool>		s_suspend_expensive	= false;
+	static std::atomic<uint64_t>	s_power_generation	= 0;
+
+	static std::mutex				s_frame_mutex;
+	static std::condition_variable	s_frame_cv;
+	static bool						s_frame_requested = false;
+
 	static std::optional<Block::Value> node_to_value(toml::node& node)
 	{
 		Block::Value result;
@@ -101,8 +120,16 @@ namespace bsbar
 
 		if (*type == "internal/battery")
 			block = std::make_unique<BatteryBlock>();
+		else if (*type == "internal/cpu")
+			block = std::make_unique<CpuBlock>();
 		else if (*type == "internal/datetime")
 			block = std::make_unique<DateTimeBlock>();
+		else if (*type == "internal/disk")
+			block = std::make_unique<DiskBlock>();
+		else if (*type == "internal/load")
+			block = std::make_unique<LoadBlock>();
+		else if (*type == "internal/memory")
+			block = std::make_unique<MemoryBlock>();
 		else if (*type == "internal/menu")
 			block = std::make_unique<MenuBlock>();
 		else if (*type == "internal/network")
@@ -138,6 +165,22 @@ namespace bsbar
 		if (!block->is_valid())
 			exit(1);
 
+		if (!block->m_value.color_ramp.empty())
+			block->m_color_ramp = std::make_unique<ColorRamp>(block->m_value.color_ramp, block->m_value.min, block->m_value.max);
+
+		if (block->m_uses_sparkline || block->m_uses_history)
+			block->m_history = std::make_unique<History>(block->m_history_size, block->m_value.min, block->m_value.max, block->m_uses_history);
+
+		if (block->m_interval_max)
+		{
+			block->m_interval_min = block->m_interval_min.value_or(block->m_interval.value_or(std::chrono::seconds(1)));
+			block->m_adaptive_interval_ms = block->m_interval_min->count();
+		}
+
+		// Shows 'format-loading' until the first update
+		std::scoped_lock _(block->m_mutex);
+		block->publish();
+
 		return block;
 	}
 
@@ -155,6 +198,32 @@ namespace bsbar
 			return false;
 		}
 
+		if (!m_value.color_ramp.empty() && m_value.max <= m_value.min)
+		{
+			std::cerr << "'value-max' must be greater than 'value-min' when 'color-ramp' is used in module '" << m_name << '\'' << std::endl;
+			return false;
+		}
+
+		if (m_interval_min && !m_interval_max)
+		{
+			std::cerr << "'interval-min' requires 'interval-max' in module '" << m_name << '\'' << std::endl;
+			return false;
+		}
+
+		if (m_interval_max)
+		{
+			if (m_interval && m_interval->count() == 0)
+			{
+				std::cerr << "'interval-max' can't be used with automatic updates disabled in module '" << m_name << '\'' << std::endl;
+				return false;
+			}
+			if (*m_interval_max < m_interval_min.value_or(m_interval.value_or(std::chrono::seconds(1))))
+			{
+				std::cerr << "'interval-max' is smaller than minimum interval in module '" << m_name << '\'' << std::endl;
+				return false;
+			}
+		}
+
 		if (!custom_is_valid())
 			return false;
 
@@ -165,9 +234,42 @@ namespace bsbar
 	{		
 		while (true)
 		{
-			auto tp = time_point::clock::now();
+			if (s_paused)
+			{
+				std::unique_lock lock(s_pause_mutex);
+				s_pause_cv.wait(lock, [this]() { return !s_paused || m_stop; });
+				if (m_stop)
+					break;
+			}
 
-			if (custom_update(tp))
+			// Updates requested by the same clock tick share the time point, so
+			// shared data sources (see Sampler) are read only once per tick
+			time_point tp;
+			bool frame_after_update;
+			{
+				std::scoped_lock _(m_mutex);
+				tp = m_request_update;
+				if (m_requested_at != std::chrono::steady_clock::time_point {})
+					m_stats.queue_wait.record(std::chrono::steady_clock::now() - std::exchange(m_requested_at, {}));
+				// First update replaces 'format-loading' text, which main loop has already shown
+				frame_after_update = std::exchange(m_frame_after_update, false) || !m_ready;
+			}
+
+			if (m_from_cache)
+			{
+				std::scoped_lock _(m_mutex);
+				m_from_cache = false;
+				if (m_color_before_cache)
+					m_i3bar["color"] = *std::exchange(m_color_before_cache, std::nullopt);
+				else
+					m_i3bar.erase("color");
+			}
+
+			auto update_start = std::chrono::steady_clock::now();
+			bool updated = custom_update(tp);
+			m_stats.update.record(std::chrono::steady_clock::now() - update_start);
+
+			if (updated)
 			{
 				std::scoped_lock _(m_mutex);
 
@@ -177,18 +279,55 @@ namespace bsbar
 				if (m_text.find("%ramp%") != std::string::npos)
 					replace_all(m_text, "%ramp%", get_ramp_string(m_value.value, m_value.min, m_value.max, m_value.ramp));
 
-				if (m_color && m_i3bar.find("color") == m_i3bar.end())
+				if (m_history)
+				{
+					m_history->push(m_value.value);
+					replace_all(m_text, "%sparkline%", m_history->sparkline());
+					replace_all(m_text, "%history%", m_history->history());
+				}
+
+				if (m_color_ramp)
+				{
+					auto& color = m_i3bar["color"];
+					color.is_string = true;
+					color.value = m_color_ramp->get(m_value.value);
+				}
+				else if (m_color && m_i3bar.find("color") == m_i3bar.end())
 					m_i3bar["color"] = { .is_string = true, .value = *m_color };
 			}
 
 			{
 				std::scoped_lock _(m_mutex);
+				bool changed = updated && publish();
+				if (m_interval_max)
+				{
+					int64_t interval = changed ? m_interval_min->count() : std::min<int64_t>(m_adaptive_interval_ms * 2, m_interval_max->count());
+					// Main loop has already scheduled the next update with the backed-off interval
+					if (interval < m_adaptive_interval_ms.exchange(interval))
+					{
+						m_reschedule = true;
+						frame_after_update = true;
+					}
+				}
 				m_last_update = tp;
+				m_ready = true;
 				m_wait_cv.notify_all();
 			}
 
+			if (frame_after_update)
+				request_frame();
+
 			std::unique_lock lock(m_mutex);
-			m_update_cv.wait(lock, [this]() { return m_request_update > m_last_update; });
+			m_update_cv.wait(lock, [this]() { return m_stop || m_request_update > m_last_update; });
+			if (m_stop)
+				break;
+		}
+
+		// Dormant block holds no threads or subscriptions of its own, wake() starts them again
+		if (m_sleeping)
+		{
+			custom_stop();
+			m_custom_running = false;
 		}
 	}
 
@@ -197,26 +336,184 @@ namespace bsbar
 		return m_signals.find(sig) != m_signals.end();
 	}
 
-	void Block::update_clock_tick(time_point tp)
+	// Deadlines are aligned to multiples of interval, e.g. interval of 60 seconds
+	// updates at the start of every minute
+	static Block::time_point next_aligned(Block::time_point tp, std::chrono::milliseconds interval)
 	{
-		custom_tick();
-		if (m_update_counter++ % m_interval)
-			return;
+		if (interval.count() == 0)
+			return Block::time_point::max();
+		auto since_epoch = std::chrono::floor<std::chrono::milliseconds>(tp.time_since_epoch());
+		return Block::time_point(since_epoch / interval * interval + interval);
+	}
+
+	Block::time_point Block::next_deadline(time_point tp) const
+	{
+		if (s_suspend_expensive && custom_is_expensive())
+			return time_point::max();
+
+		auto next = next_aligned(tp, get_interval());
+
+		// Deadlines of all blocks are rounded up to a shared boundary, so they wake up together
+		if (int64_t align = s_align_ms; align > 0 && next != time_point::max())
+		{
+			auto ms = std::chrono::floor<std::chrono::milliseconds>(next.time_since_epoch()).count();
+			next = time_point(std::chrono::milliseconds((ms + align - 1) / align * align));
+		}
+
+		return next;
+	}
+
+	bool Block::update_clock_tick(time_point tp)
+	{
+		custom_tick(tp);
+
+		// Deadlines calculated with the previous power profile may be too early or too late
+		if (uint64_t generation = s_power_generation; generation != m_power_generation)
+		{
+			m_power_generation = generation;
+			if (tp < m_next_update)
+				m_next_update = next_deadline(tp);
+		}
+
+		if (m_reschedule.exchange(false))
+			m_next_update = std::min(m_next_update, next_deadline(tp));
+
+		if (tp < m_next_update)
+			return false;
+
+		m_next_update = next_deadline(tp);
+
 		request_update(false, tp);
+		return true;
+	}
+
+	std::chrono::milliseconds Block::get_interval() const
+	{
+		auto interval = m_interval_max ? std::chrono::milliseconds(m_adaptive_interval_ms) : m_interval.value_or(std::chrono::seconds(1));
+		if (double scale = s_interval_scale; scale != 1.0)
+			interval = std::chrono::milliseconds((int64_t)std::round(interval.count() * scale));
+		return interval;
+	}
+
+	void Block::reset_interval()
+	{
+		if (!m_interval_max)
+			return;
+		if (m_adaptive_interval_ms.exchange(m_interval_min->count()) == m_interval_min->count())
+			return;
+		// Main loop may be sleeping until the old deadline
+		m_reschedule = true;
+		request_frame();
+	}
+
+	bool Block::set_data(std::string_view key, std::string_view data)
+	{
+		if (!custom_set_data(key, data))
+			return false;
+		request_async_update();
+		return true;
+	}
+
+	void Block::dump_stats(std::ostream& out) const
+	{
+		auto precision = out.precision();
+		auto print = [&out, precision](std::string_view name, const Histogram& histogram) {
+			auto summary = histogram.summarize();
+			auto to_us = [](Histogram::duration value) { return value.count() / 1000.0; };
+			out << "  " << std::left << std::setw(12) << name << std::right;
+			out << std::fixed << std::setprecision(1);
+			out << "p50 " << std::setw(9) << to_us(summary.p50) << " us";
+			out << ", p99 " << std::setw(9) << to_us(summary.p99) << " us";
+			out << ", max " << std::setw(9) << to_us(summary.max) << " us";
+			out << " (" << summary.count << ")" << std::defaultfloat << std::setprecision(precision) << std::endl;
+		};
+
+		out << "block '" << m_name << "' (" << m_type << "): interval ";
+		if (auto interval = get_interval(); interval.count() == 0)
+			out << "disabled";
+		else
+			out << interval.count() << " ms";
+		out << std::endl;
+		print("update",		m_stats.update);
+		print("queue wait",	m_stats.queue_wait);
+		print("lock wait",	m_stats.lock_wait);
 	}
 
 	void Block::request_update(bool should_block, time_point tp)
 	{
-		m_request_update = tp;
-		m_update_cv.notify_all();
+		{
+			std::scoped_lock _(m_mutex);
+			m_request_update = std::max(m_request_update, tp);
+			if (m_requested_at == std::chrono::steady_clock::time_point {})
+				m_requested_at = std::chrono::steady_clock::now();
+			m_update_cv.notify_all();
+		}
 
 		if (should_block)
 			block_until_updated(tp);
 	}
 
+	void Block::request_async_update()
+	{
+		std::scoped_lock _(m_mutex);
+		m_frame_after_update = true;
+		m_request_update = std::max(m_request_update, Clock::now());
+		if (m_requested_at == std::chrono::steady_clock::time_point {})
+			m_requested_at = std::chrono::steady_clock::now();
+		m_update_cv.notify_all();
+	}
+
+	void Block::set_paused(bool paused)
+	{
+		std::scoped_lock _(s_pause_mutex);
+		s_paused = paused;
+		s_pause_cv.notify_all();
+	}
+
+	bool Block::is_paused()
+	{
+		return s_paused;
+	}
+
+	bool Block::wait_while_paused()
+	{
+		if (!s_paused)
+			return false;
+		std::unique_lock lock(s_pause_mutex);
+		s_pause_cv.wait(lock, []() { return !s_paused; });
+		return true;
+	}
+
+	void Block::set_power_profile(const PowerProfile& profile)
+	{
+		s_interval_scale	= profile.interval_scale;
+		s_align_ms			= profile.align.count();
+		s_suspend_expensive	= profile.suspend_custom;
+		s_power_generation++;
+	}
+
+	void Block::request_frame()
+	{
+		std::scoped_lock _(s_frame_mutex);
+		s_frame_requested = true;
+		s_frame_cv.notify_all();
+	}
+
+	bool Block::wait_frame_request_until(time_point tp)
+	{
+		std::unique_lock lock(s_frame_mutex);
+		if (tp == time_point::max())
+			s_frame_cv.wait(lock, []() { return s_frame_requested; });
+		else if (!s_frame_cv.wait_until(lock, tp, []() { return s_frame_requested; }))
+			return false;
+		s_frame_requested = false;
+		return true;
+	}
+
 	void Block::wait_if_needed(time_point tp) const
 	{
-		if (!m_is_needed)
+		// Blocks still initializing are shown with 'format-loading' instead of delaying the frame
+		if (!m_is_needed || !m_ready)
 			return;
 		block_until_updated(tp);
 	}
@@ -227,37 +524,140 @@ namespace bsbar
 		m_wait_cv.wait(lock, [&]() { return m_last_update >= tp; });
 	}
 
-	void Block::print() const
+	void Block::print(std::string& out) const
 	{
+		if (!custom_print(out))
+			return;
+
+		m_snapshot.append_to(out);
+	}
+
+	bool Block::get_cache_entry(FrameCache::Entry& entry) const
+	{
+		if (!m_ready)
+			return false;
+
 		std::scoped_lock _(m_mutex);
 
-		if (!custom_print())
-			return;
+		entry.type		= m_type;
+		entry.instance	= m_name;
+		entry.text		= m_text;
+		if (auto it = m_i3bar.find("color"); it != m_i3bar.end() && it->second.is_string)
+			entry.color = it->second.value;
+		return true;
+	}
 
-		std::printf("{");
-		std::printf( "\"name\":\"%s\"",			m_type.c_str());
-		std::printf(",\"instance\":\"%s\"",		m_name.c_str());
-		std::printf(",\"full_text\":\"%s\"",	m_text.c_str());
+	void Block::restore_cache_entry(const FrameCache::Entry& entry, const std::optional<std::string>& stale_color)
+	{
+		std::scoped_lock _(m_mutex);
+
+		if (auto it = m_i3bar.find("color"); it != m_i3bar.end())
+			m_color_before_cache = it->second;
+		m_from_cache = true;
+
+		m_text = entry.text;
+		if (auto color = stale_color ? stale_color : entry.color)
+			m_i3bar["color"] = { .is_string = true, .value = *color };
+
+		publish();
+	}
+
+	bool Block::publish()
+	{
+		std::string out;
+
+		out += "{\"name\":\"";
+		out += m_type;
+		out += "\",\"instance\":\"";
+		out += m_name;
+		out += "\",\"full_text\":\"";
+		out += m_text;
+		out += '"';
 
 		for (const auto& [key, value] : m_i3bar)
 		{
+			out += ",\"";
+			out += key;
+			out += value.is_string ? "\":\"" : "\":";
+			out += value.value;
 			if (value.is_string)
-				std::printf(",\"%s\":\"%s\"", key.c_str(), value.value.c_str());
-			else
-				std::printf(",\"%s\":%s", key.c_str(), value.value.c_str());
+				out += '"';
 		}
 
-		std::printf("}");
+		out += '}';
+
+		return m_snapshot.publish(std::move(out));
 	}
 
-	void Block::initialize()
+	void Block::initialize(bool dormant)
 	{
+		m_sleeping = dormant;
+		if (dormant)
+			return;
 		custom_initialize();
+		m_custom_running = true;
 		m_thread = std::thread(&Block::update_thread, this);
 	}
 
+	void Block::request_stop()
+	{
+		{
+			std::scoped_lock _(m_mutex);
+			m_stop = true;
+			m_update_cv.notify_all();
+		}
+
+		// Thread may be waiting for resume
+		std::scoped_lock _(s_pause_mutex);
+		s_pause_cv.notify_all();
+	}
+
+	void Block::sleep()
+	{
+		m_sleeping = true;
+		request_stop();
+	}
+
+	void Block::wake(time_point tp)
+	{
+		// Thread of previous sleep() may still be finishing its update
+		if (m_thread.joinable())
+			m_thread.join();
+
+		{
+			std::scoped_lock _(m_mutex);
+			m_stop = false;
+			m_sleeping = false;
+			m_request_update = std::max(m_request_update, tp);
+		}
+
+		if (!m_custom_running)
+		{
+			custom_initialize();
+			m_custom_running = true;
+		}
+
+		m_thread = std::thread(&Block::update_thread, this);
+	}
+
+	void Block::stop()
+	{
+		request_stop();
+
+		if (m_thread.joinable())
+			m_thread.join();
+
+		if (m_custom_running)
+		{
+			custom_stop();
+			m_custom_running = false;
+		}
+	}
+
 	bool Block::handle_click(const MouseInfo& mouse, std::string_view sub)
 	{
+		reset_interval();
+
 		if (!handle_custom_click(mouse, sub))
 			return false;
 
@@ -276,7 +676,7 @@ namespace bsbar
 
 		if (!m_on_click.command.empty())
 		{
-			if (!m_on_click.is_running || !m_on_click.single_instance)
+			if (!*m_on_click.is_running || !m_on_click.single_instance)
 			{
 				pid_t pid = execute_command(m_on_click.command);
 
@@ -288,10 +688,10 @@ namespace bsbar
 					waitpid(pid, NULL, 0);
 				else
 				{
-					m_on_click.is_running = true;
-					std::thread temp = std::thread([this, pid]() {
+					*m_on_click.is_running = true;
+					std::thread temp = std::thread([is_running = m_on_click.is_running, pid]() {
 						waitpid(pid, NULL, 0);
-						m_on_click.is_running = false;
+						*is_running = false;
 					});
 					temp.detach();
 				}
@@ -304,6 +704,8 @@ namespace bsbar
 
 	bool Block::handle_scroll(const MouseInfo& mouse, std::string_view sub)
 	{
+		reset_interval();
+
 		if (!handle_custom_scroll(mouse, sub))
 			return false;
 
@@ -331,25 +733,47 @@ namespace bsbar
 		if (key == "type")
 			return;
 
+		// Alternative formats (format-muted, format-stale etc.) go through the same
+		// placeholder replacement after an update as `format`
+		if (key.starts_with("format") && key != "format-loading" && value.is_string())
+		{
+			std::string_view format = **value.as_string();
+			m_uses_sparkline	|= format.find("%sparkline%") != std::string_view::npos;
+			m_uses_history		|= format.find("%history%") != std::string_view::npos;
+		}
+
 		bool custom = this->add_custom_config(key, value);
 		if (custom)
 			return;
 
 		if (key == "interval")
 		{
-			BSBAR_VERIFY_TYPE(value, integer, key);
-			int64_t interval = **value.as_integer();
-			if (interval == 0)
-				m_interval = UINT64_MAX;
-			else if (interval > 0)
-				m_interval = interval;
+			BSBAR_VERIFY_TYPE(value, number, key);
+			double interval = value.is_integer() ? **value.as_integer() : **value.as_floating_point();
+			if (interval == 0.0)
+				m_interval = std::chrono::milliseconds::zero();
+			else if (interval >= 0.001)
+				m_interval = std::chrono::milliseconds((int64_t)std::round(interval * 1000.0));
 			else
 			{
-				std::cerr << "Value for key 'interval' must be positive integer or 0 to disable automatic updates" << std::endl;
+				std::cerr << "Value for key 'interval' must be at least 0.001 seconds or 0 to disable automatic updates" << std::endl;
 				std::cerr << "  " << value.source() << std::endl;
 				exit(1);
 			}
 		}
+		else if (key == "interval-min" || key == "interval-max")
+		{
+			BSBAR_VERIFY_TYPE(value, number, key);
+			double interval = value.is_integer() ? **value.as_integer() : **value.as_floating_point();
+			if (interval < 0.001)
+			{
+				std::cerr << "Value for key '" << key << "' must be at least 0.001 seconds" << std::endl;
+				std::cerr << "  " << value.source() << std::endl;
+				exit(1);
+			}
+			auto& target = (key == "interval-min") ? m_interval_min : m_interval_max;
+			target = std::chrono::milliseconds((int64_t)std::round(interval * 1000.0));
+		}
 		else if (key == "color")
 		{
 			BSBAR_VERIFY_TYPE(value, string, key);
@@ -385,6 +809,11 @@ namespace bsbar
 			BSBAR_VERIFY_TYPE(value, string, key);
 			m_format = **value.as_string();
 		}
+		else if (key == "format-loading")
+		{
+			BSBAR_VERIFY_TYPE(value, string, key);
+			m_text = **value.as_string();
+		}
 		else if (key == "needed")
 		{
 			BSBAR_VERIFY_TYPE(value, boolean, key);
@@ -401,6 +830,41 @@ namespace bsbar
 				m_value.ramp.push_back(**elem.as_string());
 			}
 		}
+		else if (key == "color-ramp")
+		{
+			BSBAR_VERIFY_TYPE_CUSTOM_MESSAGE(value, array, "value for key 'color-ramp' must be an array of colors (\"#rrggbb\")");
+
+			m_value.color_ramp.clear();
+			for (auto&& elem : *value.as_array())
+			{
+				if (!elem.is_string() || !ColorRamp::is_valid_color(**elem.as_string()))
+				{
+					std::cerr << "value for key 'color-ramp' must be an array of colors (\"#rrggbb\")" << std::endl;
+					std::cerr << "  " << elem.source() << std::endl;
+					exit(1);
+				}
+				m_value.color_ramp.push_back(**elem.as_string());
+			}
+
+			if (m_value.color_ramp.empty())
+			{
+				std::cerr << "value for key 'color-ramp' must contain at least one color" << std::endl;
+				std::cerr << "  " << value.source() << std::endl;
+				exit(1);
+			}
+		}
+		else if (key == "history-size")
+		{
+			BSBAR_VERIFY_TYPE(value, integer, key);
+			int64_t size = **value.as_integer();
+			if (size < 1 || size > (int64_t)History::max_capacity)
+			{
+				std::cerr << "Value for key 'history-size' must be between 1 and " << History::max_capacity << std::endl;
+				std::cerr << "  " << value.source() << std::endl;
+				exit(1);
+			}
+			m_history_size = size;
+		}
 		else if (key == "value-min")
 		{
 			BSBAR_VERIFY_TYPE(value, number, key);
@@ -413,7 +877,7 @@ namespace bsbar
 		{
 			BSBAR_VERIFY_TYPE(value, number, key);
 			if (value.is_integer())
-				m_value.min = **value.as_integer();
+				m_value.max = **value.as_integer();
 			else
 				m_value.max = **value.as_floating_point();
 		}
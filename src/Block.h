@@ -1,5 +1,12 @@
 #pragma once
 
+#include "Cache.h"
+#include "Clock.h"
+#include "ColorRamp.h"
+#include "Histogram.h"
+#include "History.h"
+#include "Power.h"
+#include "Published.h"
 #include "toml_include.h"
 
 #include <atomic>
@@ -15,7 +22,7 @@ namespace bsbar
 	class Block
 	{
 	public:
-		using time_point = std::chrono::system_clock::time_point;
+		using time_point = Clock::time_point;
 
 		struct Value {
 			bool		is_string;
@@ -31,26 +38,79 @@ namespace bsbar
 			MouseType	type;
 			int			pos[2];
 			int			size[2];
+			int			count = 1; // number of merged scroll steps
 		};
 
 	public:
+		virtual ~Block() = default;
+
 		static std::unique_ptr<Block> create(std::string_view name, toml::table& table);
 		bool is_valid() const;
 
-		void print() const;
+		// Appends last published i3bar JSON object of the block to `out`. Does not lock the block,
+		// so a block that is updating or handling a click does not delay frames.
+		void print(std::string& out) const;
+
+		// Output of the last update for FrameCache, false if block has not been updated yet
+		bool get_cache_entry(FrameCache::Entry& entry) const;
+		// Shows output cached by a previous run until the first update. Must be called before initialize().
+		// `stale_color` is used instead of the cached color if set.
+		void restore_cache_entry(const FrameCache::Entry& entry, const std::optional<std::string>& stale_color);
+
+		// Dormant block is initialized without update thread or custom_initialize(), see wake()
+		void initialize(bool dormant = false);
+		// Stops update thread and everything started by custom_initialize(). Block must not be used afterwards.
+		void stop();
 
-		void initialize();
+		// Asks update thread to exit after its current update without waiting for it. The thread
+		// calls custom_stop() on its way out. Updates requested while dormant are done on wake().
+		void sleep();
+		// Runs custom_initialize() if needed and starts update thread again, which updates the
+		// block for `tp` right away
+		void wake(time_point tp);
+
+		// True once the first update after initialize() has finished
+		bool is_ready() const					{ return m_ready; }
 
 		const std::string& get_name() const		{ return m_type; }
 		const std::string& get_instance() const	{ return m_name; }
 
-		void update_clock_tick(time_point tp);
-		void request_update(bool should_block, time_point tp = time_point::clock::now());
+		// Returns true if block was due and an update was requested
+		bool update_clock_tick(time_point tp);
+		// Interval used for the next deadline, zero if automatic updates are disabled
+		std::chrono::milliseconds get_interval() const;
+		// Drops adaptive interval back to 'interval-min', e.g. after a click or signal
+		void reset_interval();
+		time_point get_next_update() const		{ return m_next_update; }
+		void request_update(bool should_block, time_point tp = Clock::now());
+		void request_async_update();
 		void wait_if_needed(time_point tp) const;
 		void block_until_updated(time_point tp) const;
 
 		bool handles_signal(int signal) const;
 
+		// Data pushed from outside (see control socket). Returns false if block does not accept `key`.
+		bool set_data(std::string_view key, std::string_view data);
+
+		// Writes p50/p99/max of update duration, queue wait and lock wait
+		void dump_stats(std::ostream& out) const;
+
+		// No block is updated while paused (i3bar hidden, see stop_signal in i3bar protocol).
+		// Updates requested meanwhile are done once resumed.
+		static void set_paused(bool paused);
+		static bool is_paused();
+		// Returns true if had to wait for resume
+		static bool wait_while_paused();
+
+		// Scheduling of every block follows the active power profile. Blocks recalculate
+		// their deadline on their next clock tick.
+		static void set_power_profile(const PowerProfile& profile);
+
+		// Asks main loop to output a new frame before its next tick
+		static void request_frame();
+		// Returns true if a frame was requested before `tp`
+		static bool wait_frame_request_until(time_point tp);
+
 		bool handle_click(const MouseInfo& mouse, std::string_view sub);
 		bool handle_scroll(const MouseInfo& mouse, std::string_view sub);
 
@@ -58,24 +118,38 @@ namespace bsbar
 		void add_subconfig(std::string_view sub, toml::table& table);
 
 	protected:
+		// Called again after custom_stop() when a dormant block wakes up
 		virtual void custom_initialize() {};
+		virtual void custom_stop() {};
 
-		virtual void custom_tick() {};
+		virtual void custom_tick(time_point) {};
 
 		virtual bool custom_is_valid() const { return true; }
+		// Expensive blocks (e.g. running external commands) are not scheduled while the power profile suspends them
+		virtual bool custom_is_expensive() const { return false; }
 		virtual void custom_config_done() {}
 
 		virtual bool custom_update(time_point tp) = 0;
-		virtual bool custom_print() const { return true; }
+		virtual bool custom_print(std::string&) const { return true; }
 
 		virtual bool handle_custom_click(const MouseInfo& mouse, std::string_view sub) { return true; }
 		virtual bool handle_custom_scroll(const MouseInfo& mouse, std::string_view sub) { return true; }
 
+		virtual bool custom_set_data(std::string_view, std::string_view) { return false; }
+
 		virtual bool add_custom_config(std::string_view key, toml::node& value) { return false; }
 		virtual bool add_custom_subconfig(std::string_view sub, toml::table& table) { return false; }
 
+		// Renders block to the snapshot read by print(). m_mutex must be held.
+		// Returns false if the rendered output did not change.
+		bool publish();
+
 	private:
 		void update_thread();
+		void request_stop();
+
+		// Next deadline after `tp` with the active power profile applied
+		time_point next_deadline(time_point tp) const;
 
 	protected:
 		std::string									m_type;
@@ -84,8 +158,20 @@ namespace bsbar
 
 		std::optional<std::string>					m_color;
 
-		std::atomic<uint64_t>						m_interval			= 1;
-		std::atomic<uint64_t>						m_update_counter	= 0;
+		// Unset means default of one second, zero disables automatic updates.
+		// Only accessed by the main thread after configuration.
+		std::optional<std::chrono::milliseconds>	m_interval;
+		time_point									m_next_update		= {};
+
+		// Adaptive scheduling is enabled by 'interval-max'. Interval doubles every time the output
+		// stays the same, up to 'interval-max', and drops to 'interval-min' when the output changes.
+		std::optional<std::chrono::milliseconds>	m_interval_min;
+		std::optional<std::chrono::milliseconds>	m_interval_max;
+		std::atomic<int64_t>						m_adaptive_interval_ms	= 0;
+		std::atomic<bool>							m_reschedule			= false;
+
+		// Power profile generation m_next_update was calculated with, main thread only
+		uint64_t									m_power_generation		= 0;
 
 	public:
 		std::unordered_map<std::string, Value>		m_i3bar;
@@ -102,16 +188,26 @@ namespace bsbar
 			double						value		=   0.0;
 			int							precision	=   0;
 			std::vector<std::string>	ramp;
+			std::vector<std::string>	color_ramp;
 		} m_value;
+		// Built from 'color-ramp' once configuration is done
+		std::unique_ptr<const ColorRamp>			m_color_ramp;
+		// Recent values for %sparkline% and %history%, only allocated if format uses them
+		std::size_t									m_history_size		= 16;
+		// Set if any format used after an update contains %sparkline% or %history%
+		bool										m_uses_sparkline	= false;
+		bool										m_uses_history		= false;
+		std::unique_ptr<History>					m_history;
 
 		enum class SliderOptions { None, On, Off, Toggle };
 		struct
 		{
 			std::string			command;
 			std::atomic<bool>	blocking		= false;
-			std::atomic<bool>	is_running		= false;
 			std::atomic<bool>	single_instance	= false;
 			SliderOptions		slider_options;
+			// Shared with the thread waiting for the command, which may outlive the block
+			std::shared_ptr<std::atomic<bool>>	is_running = std::make_shared<std::atomic<bool>>(false);
 		} m_on_click;
 		struct
 		{
@@ -119,14 +215,35 @@ namespace bsbar
 		} m_on_slider_click;
 		std::atomic<bool>							m_show_slider = false;
 
+		// Recorded in nanoseconds since the block was created
+		struct
+		{
+			Histogram	update;			// custom_update() duration
+			Histogram	queue_wait;		// from update request to start of the update
+			Histogram	lock_wait;		// waiting for m_mutex
+		} mutable m_stats;
+		std::chrono::steady_clock::time_point		m_requested_at		= {};
+
 		std::atomic<bool>							m_is_needed			= false;
-		time_point									m_last_update		= time_point::clock::now();
-		time_point									m_request_update	= time_point::clock::now();
-		mutable std::condition_variable				m_wait_cv;
-		std::condition_variable						m_update_cv;
+		bool										m_frame_after_update = false;
+		std::atomic<bool>							m_stop				= false;
+		std::atomic<bool>							m_sleeping			= false;
+		// Owned by update thread while it runs, by initialize(), wake() and stop() otherwise
+		bool										m_custom_running	= false;
+		std::atomic<bool>							m_ready				= false;
+		time_point									m_last_update		= Clock::now();
+		time_point									m_request_update	= Clock::now();
+		mutable std::condition_variable_any			m_wait_cv;
+		std::condition_variable_any					m_update_cv;
 
 		std::thread 								m_thread;
-		mutable std::mutex							m_mutex;
+		mutable TimedMutex							m_mutex { m_stats.lock_wait };
+
+		PublishedString								m_snapshot;
+
+		// Color before restore_cache_entry(), put back before the first update
+		bool										m_from_cache		= false;
+		std::optional<Value>						m_color_before_cache;
 	};
 
 }
\ No newline at end of file
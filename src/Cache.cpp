@@ -0,0 +1,144 @@
+#include "Cache.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bsbar
+{
+
+	// File starts with the magic line, followed by entries of length prefixed fields:
+	// type, instance, text and color (empty color means none is set)
+	static constexpr std::string_view s_magic = "bsbar-cache 1\n";
+
+	static void append_field(std::string& out, std::string_view field)
+	{
+		uint32_t size = field.size();
+		out.append((const char*)&size, sizeof(size));
+		out.append(field);
+	}
+
+	static bool read_field(std::string_view& in, std::string& field)
+	{
+		uint32_t size;
+		if (in.size() < sizeof(size))
+			return false;
+		std::memcpy(&size, in.data(), sizeof(size));
+		in.remove_prefix(sizeof(size));
+
+		if (in.size() < size)
+			return false;
+		field.assign(in.data(), size);
+		in.remove_prefix(size);
+		return true;
+	}
+
+	std::string FrameCache::default_path()
+	{
+		const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+		if (runtime_dir == nullptr || *runtime_dir == '\0')
+			return {};
+		return std::string(runtime_dir) + "/bsbar.cache";
+	}
+
+	FrameCache::FrameCache(std::string path)
+		: m_path(std::move(path))
+	{ }
+
+	std::vector<FrameCache::Entry> FrameCache::load() const
+	{
+		int fd = open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd == -1)
+			return {};
+
+		struct stat st;
+		if (fstat(fd, &st) == -1 || st.st_size <= (off_t)s_magic.size())
+		{
+			close(fd);
+			return {};
+		}
+
+		void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED)
+			return {};
+
+		std::vector<Entry> entries;
+
+		std::string_view in((const char*)data, st.st_size);
+		if (in.starts_with(s_magic))
+		{
+			in.remove_prefix(s_magic.size());
+			while (!in.empty())
+			{
+				Entry entry;
+				std::string color;
+				if (!read_field(in, entry.type) || !read_field(in, entry.instance) || !read_field(in, entry.text) || !read_field(in, color))
+				{
+					std::cerr << "Ignoring corrupted cache '" << m_path << '\'' << std::endl;
+					entries.clear();
+					break;
+				}
+				if (!color.empty())
+					entry.color = std::move(color);
+				entries.push_back(std::move(entry));
+			}
+		}
+
+		munmap(data, st.st_size);
+		return entries;
+	}
+
+	bool FrameCache::store(const std::vector<Entry>& entries, std::chrono::steady_clock::time_point now)
+	{
+		m_next_store = now + store_interval;
+
+		std::string out(s_magic);
+		for (const auto& entry : entries)
+		{
+			append_field(out, entry.type);
+			append_field(out, entry.instance);
+			append_field(out, entry.text);
+			append_field(out, entry.color.value_or(""));
+		}
+
+		if (out == m_last_written)
+			return true;
+
+		// Readers see either the old or the new file, never a partial write
+		std::string temp_path = m_path + ".tmp." + std::to_string(getpid());
+		int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+		if (fd == -1)
+		{
+			std::cerr << "open(\"" << temp_path << "\")\n  " << strerror(errno) << std::endl;
+			return false;
+		}
+
+		std::size_t written = 0;
+		while (written < out.size())
+		{
+			ssize_t nwrite = write(fd, out.data() + written, out.size() - written);
+			if (nwrite == -1 && errno == EINTR)
+				continue;
+			if (nwrite <= 0)
+				break;
+			written += nwrite;
+		}
+		close(fd);
+
+		if (written != out.size() || rename(temp_path.c_str(), m_path.c_str()) == -1)
+		{
+			std::cerr << "Could not write cache '" << m_path << "'\n  " << strerror(errno) << std::endl;
+			unlink(temp_path.c_str());
+			return false;
+		}
+
+		m_last_written = std::move(out);
+		m_write_count++;
+		return true;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace bsbar
+{
+
+	// Last output of every block, kept between runs so a restarted bar has text before blocks
+	// finish their first update. Writes replace the file atomically and are rate limited.
+	class FrameCache
+	{
+	public:
+		struct Entry
+		{
+			std::string					type;
+			std::string					instance;
+			std::string					text;
+			std::optional<std::string>	color;
+		};
+
+		static constexpr auto store_interval = std::chrono::seconds(30);
+
+	public:
+		// $XDG_RUNTIME_DIR/bsbar.cache, or empty if XDG_RUNTIME_DIR is not set
+		static std::string default_path();
+
+		FrameCache(std::string path);
+
+		// Entries written by a previous run. Empty if cache is missing or invalid.
+		std::vector<Entry> load() const;
+
+		// True once `store_interval` has passed since the previous store
+		bool is_store_due(std::chrono::steady_clock::time_point now) const { return now >= m_next_store; }
+
+		// Writes `entries` to a temporary file renamed over the cache. Nothing is written
+		// if they equal the previous store. Returns false on failure.
+		bool store(const std::vector<Entry>& entries, std::chrono::steady_clock::time_point now);
+
+		uint64_t get_write_count() const { return m_write_count; }
+
+	private:
+		std::string								m_path;
+		std::string								m_last_written;
+		std::chrono::steady_clock::time_point	m_next_store	= {};
+		std::atomic<uint64_t>					m_write_count	= 0;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "Clock.h"
+
+namespace bsbar
+{
+
+	std::atomic<bool>							Clock::s_simulated			= false;
+	std::atomic<Clock::time_point::rep>			Clock::s_simulated_now		= 0;
+
+	Clock::time_point Clock::now()
+	{
+		if (s_simulated)
+			return time_point(time_point::duration(s_simulated_now.load()));
+		return std::chrono::system_clock::now();
+	}
+
+	void Clock::start_simulation(time_point start)
+	{
+		s_simulated_now = start.time_since_epoch().count();
+		s_simulated = true;
+	}
+
+	void Clock::advance(time_point tp)
+	{
+		s_simulated_now = tp.time_since_epoch().count();
+	}
+
+}
\ No newline at end of file
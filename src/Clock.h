@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+namespace bsbar
+{
+
+	// Time source of the scheduler and blocks. Normally this is the system clock, but in
+	// simulation (see --simulate) time is fake and only moves when the scheduler advances it.
+	class Clock
+	{
+	public:
+		using time_point = std::chrono::system_clock::time_point;
+
+	public:
+		static time_point now();
+
+		static bool is_simulated() { return s_simulated; }
+
+		// Must be called before any blocks are created
+		static void start_simulation(time_point start);
+		static void advance(time_point tp);
+
+	private:
+		static std::atomic<bool>					s_simulated;
+		static std::atomic<time_point::rep>			s_simulated_now;
+	};
+
+}
\ No newline at end of file
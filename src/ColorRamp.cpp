@@ -0,0 +1,69 @@
+#include "ColorRamp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace bsbar
+{
+
+	static int hex_digit(char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	}
+
+	bool ColorRamp::is_valid_color(std::string_view color)
+	{
+		if (color.size() != 7 || color.front() != '#')
+			return false;
+		return std::all_of(color.begin() + 1, color.end(), [](char c) { return hex_digit(c) != -1; });
+	}
+
+	ColorRamp::ColorRamp(const std::vector<std::string>& stops, double min, double max)
+		: m_min(min)
+		, m_scale((size - 1) / (max - min))
+	{
+		struct Rgb { double channel[3]; };
+
+		std::vector<Rgb> rgb;
+		for (const auto& stop : stops)
+		{
+			Rgb color;
+			for (int i = 0; i < 3; i++)
+				color.channel[i] = hex_digit(stop[1 + i * 2]) * 16 + hex_digit(stop[2 + i * 2]);
+			rgb.push_back(color);
+		}
+
+		for (std::size_t i = 0; i < size; i++)
+		{
+			// Position between the stops, last segment includes the final stop
+			double t = (double)i / (size - 1) * (rgb.size() - 1);
+			std::size_t segment = std::min<std::size_t>(t, rgb.size() > 1 ? rgb.size() - 2 : 0);
+			double fraction = t - segment;
+
+			const auto& a = rgb[segment];
+			const auto& b = rgb[std::min(segment + 1, rgb.size() - 1)];
+
+			int channel[3];
+			for (int c = 0; c < 3; c++)
+				channel[c] = (int)std::round(a.channel[c] + (b.channel[c] - a.channel[c]) * fraction);
+
+			std::snprintf(m_colors[i], sizeof(m_colors[i]), "#%02x%02x%02x", channel[0], channel[1], channel[2]);
+		}
+	}
+
+	std::string_view ColorRamp::get(double value) const
+	{
+		double index = (value - m_min) * m_scale;
+		// Also catches NaN
+		if (!(index > 0.0))
+			return m_colors[0];
+		if (index >= size - 1)
+			return m_colors[size - 1];
+		return m_colors[(std::size_t)(index + 0.5)];
+	}
+
+}
\ No newline at end of file
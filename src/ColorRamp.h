@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bsbar
+{
+
+	// Maps values between `min` and `max` to colors interpolated between evenly spaced stops.
+	// Every color is formatted when the ramp is created, picking one is a table lookup.
+	class ColorRamp
+	{
+	public:
+		static constexpr std::size_t size = 256;
+
+	public:
+		// `stops` must contain at least one valid color and `max` must be greater than `min`
+		ColorRamp(const std::vector<std::string>& stops, double min, double max);
+
+		// Returns true if `color` is of form "#rrggbb"
+		static bool is_valid_color(std::string_view color);
+
+		// Values outside of the range get the color of the nearest end
+		std::string_view get(double value) const;
+
+	private:
+		double	m_min;
+		double	m_scale;
+		char	m_colors[size][8];
+	};
+
+}
\ No newline at end of file
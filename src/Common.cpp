@@ -21,8 +21,11 @@ namespace bsbar
 	std::string_view get_ramp_string(double value, double min, double max, const std::vector<std::string>& ramp)
 	{
 		double per_ramp = (max - min) / (double)ramp.size();
-		std::size_t index = std::clamp<std::size_t>(value / per_ramp, 0, ramp.size() - 1);
-		return ramp[index];
+		double index = (value - min) / per_ramp;
+		// Also catches NaN
+		if (!(index > 0.0))
+			return ramp.front();
+		return ramp[(std::size_t)std::min<double>(index, ramp.size() - 1)];
 	}
 
 	std::string value_to_string(double value, int precision)
@@ -32,6 +35,35 @@ namespace bsbar
 		return ss.str();
 	}
 
+	std::string bytes_to_string(double bytes, int precision)
+	{
+		static constexpr const char* units[] = { "B", "KiB", "MiB", "GiB", "TiB", "PiB" };
+
+		std::size_t unit = 0;
+		while (bytes >= 1024.0 && unit + 1 < std::size(units))
+		{
+			bytes /= 1024.0;
+			unit++;
+		}
+
+		return value_to_string(bytes, unit ? precision : 0) + units[unit];
+	}
+
+	// Set once at startup before blocks are created
+	static std::string s_system_root;
+
+	void set_system_root(std::string root)
+	{
+		while (!root.empty() && root.back() == '/')
+			root.pop_back();
+		s_system_root = std::move(root);
+	}
+
+	std::string system_path(std::string_view path)
+	{
+		return s_system_root + std::string(path);
+	}
+
 	std::vector<std::string_view> split(std::string_view sv, char c)
 	{
 		return split(sv, [c](char ch) { return ch == c; });
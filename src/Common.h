@@ -21,6 +21,13 @@ namespace bsbar
 
 	std::string value_to_string(double value, int percision);
 
+	// Formats byte count with binary prefix, e.g. 3.2GiB
+	std::string bytes_to_string(double bytes, int precision);
+
+	// Prefix for /proc and /sys paths, so blocks can be run against fixture files (see --simulate)
+	void set_system_root(std::string root);
+	std::string system_path(std::string_view path);
+
 	std::vector<std::string_view> split(std::string_view sv, char c);
 	std::vector<std::string_view> split(std::string_view sv, const std::function<bool(char)>& comp);
 
@@ -3,19 +3,47 @@
 
 #include "Common.h"
 
+#include <fcntl.h>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 namespace bsbar
 {
 
+	std::optional<std::string> read_config(const std::string& config_path)
+	{
+		std::ifstream file(config_path);
+		if (!file)
+			return {};
+		std::stringstream ss;
+		ss << file.rdbuf();
+		return ss.str();
+	}
+
 	ConfigResult parse_config(std::string_view config_path)
 	{
-		auto parse_result = toml::parse_file(config_path);
+		auto content = read_config(std::string(config_path));
+		if (!content)
+		{
+			std::cerr << "Could not open config file '" << config_path << '\'' << std::endl;
+			exit(1);
+		}
+		return parse_config_string(*content, config_path);
+	}
+
+	ConfigResult parse_config_string(std::string_view content, std::string_view source_path)
+	{
+		auto parse_result = toml::parse(content, source_path);
 		if (!parse_result)
 		{
 			std::cerr << "Error while parsing file:" << std::endl;
 			std::cerr << parse_result.error() << std::endl;
-			return {};
+			exit(1);
 		}
 
 		auto config = std::move(parse_result).table();
@@ -45,6 +73,34 @@ namespace bsbar
 			}
 		}
 
+		auto scroll_window = config["scroll-window"];
+		if (scroll_window)
+		{
+			BSBAR_VERIFY_TYPE((*scroll_window.node()), integer, "scroll-window");
+			config_result.scroll_window = scroll_window.as_integer()->get();
+			if (config_result.scroll_window < 0)
+			{
+				std::cerr << "value for global key 'scroll-window' must be a non-negative integer" << std::endl;
+				std::cerr << "  " << scroll_window.node()->source() << std::endl;
+				exit(1);
+			}
+		}
+
+		if (auto cache = config["cache"])
+		{
+			BSBAR_VERIFY_TYPE((*cache.node()), boolean, "cache");
+			config_result.cache = cache.as_boolean()->get();
+		}
+
+		if (auto stale_color = config["stale-color"])
+		{
+			BSBAR_VERIFY_TYPE((*stale_color.node()), string, "stale-color");
+			config_result.stale_color = stale_color.as_string()->get();
+		}
+
+		if (auto power_profile = config["power-profile"])
+			config_result.power_config = parse_power_config(*power_profile.node());
+
 		for (auto& node : *order_or_error.as_array())
 		{
 			BSBAR_VERIFY_TYPE_CUSTOM_MESSAGE(node, string, "value for key 'order' must be an array of strings");
@@ -60,9 +116,113 @@ namespace bsbar
 
 			auto block = Block::create(module, *module_config.as_table());
 			config_result.blocks.push_back(std::move(block));
+			config_result.block_configs.push_back(*module_config.as_table());
 		}
 
 		return config_result;
 	}
 
+	bool validate_config(std::string_view content, std::string_view source_path)
+	{
+		// Socket is used instead of a pipe so writing to an exited child does not raise SIGPIPE
+		int fds[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1)
+		{
+			std::cerr << "socketpair()\n  " << strerror(errno) << std::endl;
+			return false;
+		}
+
+		std::string source(source_path);
+
+		pid_t pid = fork();
+		if (pid == -1)
+		{
+			std::cerr << "fork()\n  " << strerror(errno) << std::endl;
+			close(fds[0]);
+			close(fds[1]);
+			return false;
+		}
+
+		if (pid == 0)
+		{
+			dup2(fds[0], STDIN_FILENO);
+			if (int fd = open("/dev/null", O_WRONLY); fd != -1)
+				dup2(fd, STDOUT_FILENO);
+			execl("/proc/self/exe", "bsbar", "--check-config", "-", source.c_str(), (char*)NULL);
+			_exit(1);
+		}
+
+		close(fds[0]);
+
+		// Content is written from here so the child sees exactly what is parsed afterwards
+		bool written = true;
+		for (std::size_t offset = 0; offset < content.size(); )
+		{
+			ssize_t nwrite = send(fds[1], content.data() + offset, content.size() - offset, MSG_NOSIGNAL);
+			if (nwrite == -1 && errno == EINTR)
+				continue;
+			if (nwrite <= 0)
+			{
+				written = false;
+				break;
+			}
+			offset += nwrite;
+		}
+		close(fds[1]);
+
+		int status;
+		while (waitpid(pid, &status, 0) == -1)
+			if (errno != EINTR)
+				return false;
+
+		return written && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+
+	ConfigWatcher::ConfigWatcher(const std::string& config_path)
+	{
+		auto slash = config_path.rfind('/');
+		std::string directory	= slash == std::string::npos ? "." : config_path.substr(0, slash + 1);
+		m_file_name				= slash == std::string::npos ? config_path : config_path.substr(slash + 1);
+
+		m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_fd == -1)
+		{
+			std::cerr << "inotify_init1()\n  " << strerror(errno) << std::endl;
+			return;
+		}
+
+		if (inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) == -1)
+		{
+			std::cerr << "inotify_add_watch(\"" << directory << "\")\n  " << strerror(errno) << std::endl;
+			close(m_fd);
+			m_fd = -1;
+		}
+	}
+
+	ConfigWatcher::~ConfigWatcher()
+	{
+		if (m_fd != -1)
+			close(m_fd);
+	}
+
+	bool ConfigWatcher::read_events()
+	{
+		bool changed = false;
+
+		alignas(inotify_event) char buffer[4096];
+		ssize_t nread;
+		while ((nread = read(m_fd, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* ptr = buffer; ptr < buffer + nread; )
+			{
+				auto* event = (inotify_event*)ptr;
+				if (event->len && m_file_name == event->name)
+					changed = true;
+				ptr += sizeof(inotify_event) + event->len;
+			}
+		}
+
+		return changed;
+	}
+
 }
\ No newline at end of file
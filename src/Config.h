@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Block.h"
+#include "Power.h"
 
 namespace bsbar
 {
@@ -8,10 +9,45 @@ namespace bsbar
 	struct ConfigResult
 	{
 		int64_t thread_pool_size = 5;
+		int64_t scroll_window = 25;
+
+		// Output is cached for the next start, see FrameCache. Only read at startup.
+		bool cache = true;
+		std::optional<std::string> stale_color;
+
+		// Set if config has a [power-profile] section
+		std::optional<PowerConfig> power_config;
 
 		std::vector<std::unique_ptr<Block>> blocks;
+		// Module tables of `blocks` used to find unchanged blocks on reload
+		std::vector<toml::table> block_configs;
 	};
 
+	std::optional<std::string> read_config(const std::string& config_path);
+
 	ConfigResult parse_config(std::string_view config_path);
+	ConfigResult parse_config_string(std::string_view content, std::string_view source_path);
+
+	// Parses config in a child process (`bsbar --check-config -`), since errors in config exit the process.
+	// Returns true if config is valid. Errors are written to stderr by the child.
+	bool validate_config(std::string_view content, std::string_view source_path);
+
+	// Reports changes of the config file. Editors often replace the file instead
+	// of writing to it, so the containing directory is watched.
+	class ConfigWatcher
+	{
+	public:
+		ConfigWatcher(const std::string& config_path);
+		~ConfigWatcher();
+
+		int get_fd() const { return m_fd; }
+
+		// Reads pending events, returns true if any of them was about the config file
+		bool read_events();
+
+	private:
+		int			m_fd = -1;
+		std::string	m_file_name;
+	};
 
 }
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "Control.h"
+
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace bsbar
+{
+
+	static constexpr std::size_t s_max_clients		= 16;
+	static constexpr std::size_t s_max_line_length	= 4096;
+
+	static std::string_view next_word(std::string_view& sv)
+	{
+		while (!sv.empty() && sv.front() == ' ')
+			sv.remove_prefix(1);
+		auto end = sv.find(' ');
+		auto word = sv.substr(0, end);
+		sv.remove_prefix(end == std::string_view::npos ? sv.size() : end + 1);
+		return word;
+	}
+
+	std::optional<ControlCommand> parse_control_command(std::string_view line)
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+
+		ControlCommand command;
+
+		auto type = next_word(line);
+		if (type == "update")
+			command.type = ControlCommand::Type::Update;
+		else if (type == "set")
+			command.type = ControlCommand::Type::Set;
+		else
+			return {};
+
+		command.instance = next_word(line);
+		if (command.instance.empty())
+			return {};
+
+		if (command.type == ControlCommand::Type::Update)
+			return line.find_first_not_of(' ') == std::string_view::npos ? std::optional(command) : std::nullopt;
+
+		// Data is the rest of the line and may contain spaces
+		command.key		= next_word(line);
+		command.data	= line;
+		if (command.key.empty())
+			return {};
+
+		return command;
+	}
+
+	std::string ControlSocket::default_path()
+	{
+		const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+		if (runtime_dir == nullptr || *runtime_dir == '\0')
+			return {};
+		return std::string(runtime_dir) + "/bsbar.sock";
+	}
+
+	ControlSocket::ControlSocket(std::string path)
+		: m_path(std::move(path))
+	{
+		sockaddr_un addr {};
+		addr.sun_family = AF_UNIX;
+		if (m_path.empty() || m_path.size() >= sizeof(addr.sun_path))
+		{
+			std::cerr << "invalid control socket path '" << m_path << '\'' << std::endl;
+			return;
+		}
+		std::strcpy(addr.sun_path, m_path.c_str());
+
+		m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (m_fd == -1)
+		{
+			std::cerr << "socket()\n  " << strerror(errno) << std::endl;
+			return;
+		}
+
+		int result = bind(m_fd, (sockaddr*)&addr, sizeof(addr));
+		if (result == -1 && errno == EADDRINUSE)
+		{
+			// Socket is left behind if bsbar was killed. It is only replaced if nobody listens to it.
+			int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			bool in_use = probe != -1 && connect(probe, (sockaddr*)&addr, sizeof(addr)) == 0;
+			if (probe != -1)
+				close(probe);
+
+			if (in_use)
+			{
+				std::cerr << "control socket '" << m_path << "' is used by another process" << std::endl;
+				close(m_fd);
+				m_fd = -1;
+				m_path.clear();
+				return;
+			}
+
+			unlink(m_path.c_str());
+			result = bind(m_fd, (sockaddr*)&addr, sizeof(addr));
+		}
+
+		if (result == -1 || listen(m_fd, 8) == -1)
+		{
+			std::cerr << "bind(\"" << m_path << "\")\n  " << strerror(errno) << std::endl;
+			close(m_fd);
+			m_fd = -1;
+			m_path.clear();
+		}
+	}
+
+	ControlSocket::~ControlSocket()
+	{
+		if (m_fd == -1)
+			return;
+		close(m_fd);
+		unlink(m_path.c_str());
+	}
+
+	void ControlSocket::run(const std::function<std::string(std::string_view)>& handler)
+	{
+		struct Client
+		{
+			int			fd;
+			std::string	buffer;
+		};
+		std::vector<Client> clients;
+
+		auto handle_line = [&](const Client& client, std::string_view line) {
+			if (line.empty())
+				return;
+			std::string error = handler(line);
+			if (error.empty())
+				return;
+			error = "error: " + error + '\n';
+			send(client.fd, error.data(), error.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+		};
+
+		std::vector<pollfd> fds;
+		while (true)
+		{
+			fds.clear();
+			fds.push_back({ .fd = m_fd, .events = POLLIN, .revents = 0 });
+			for (const auto& client : clients)
+				fds.push_back({ .fd = client.fd, .events = POLLIN, .revents = 0 });
+
+			if (poll(fds.data(), fds.size(), -1) == -1)
+			{
+				if (errno == EINTR)
+					continue;
+				std::cerr << "poll()\n  " << strerror(errno) << std::endl;
+				return;
+			}
+
+			for (std::size_t i = clients.size(); i > 0; i--)
+			{
+				if (fds[i].revents == 0)
+					continue;
+
+				auto& client = clients[i - 1];
+
+				char buffer[4096];
+				ssize_t nread = read(client.fd, buffer, sizeof(buffer));
+				if (nread > 0)
+					client.buffer.append(buffer, nread);
+
+				// Every complete line is a command, so one write can contain many of them
+				std::size_t start = 0;
+				for (std::size_t end; (end = client.buffer.find('\n', start)) != std::string::npos; start = end + 1)
+					handle_line(client, std::string_view(client.buffer).substr(start, end - start));
+				client.buffer.erase(0, start);
+
+				if (nread == -1 && (errno == EINTR || errno == EAGAIN))
+					continue;
+
+				if (nread > 0)
+				{
+					if (client.buffer.size() <= s_max_line_length)
+						continue;
+					constexpr std::string_view error = "error: line too long\n";
+					send(client.fd, error.data(), error.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+				}
+
+				// Last line does not need a newline
+				if (nread == 0)
+					handle_line(client, client.buffer);
+
+				close(client.fd);
+				clients.erase(clients.begin() + (i - 1));
+			}
+
+			if (fds[0].revents & POLLIN)
+			{
+				int fd = accept4(m_fd, nullptr, nullptr, SOCK_CLOEXEC);
+				if (fd == -1)
+					continue;
+				if (clients.size() >= s_max_clients)
+				{
+					close(fd);
+					continue;
+				}
+				clients.push_back({ .fd = fd, .buffer = {} });
+			}
+		}
+	}
+
+}
\ No newline at end of file
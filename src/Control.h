@@ -0,0 +1,48 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace bsbar
+{
+
+	// One line of the control protocol:
+	//   update <instance>
+	//   set <instance> <key> <data>
+	struct ControlCommand
+	{
+		enum class Type { Update, Set };
+
+		Type				type;
+		std::string_view	instance;
+		std::string_view	key;
+		std::string_view	data;
+	};
+
+	std::optional<ControlCommand> parse_control_command(std::string_view line);
+
+	// Listening unix stream socket. Clients write newline separated commands,
+	// any number of them per write, and get a line back for every failed command.
+	class ControlSocket
+	{
+	public:
+		// $XDG_RUNTIME_DIR/bsbar.sock, or empty if XDG_RUNTIME_DIR is not set
+		static std::string default_path();
+
+		ControlSocket(std::string path);
+		~ControlSocket();
+
+		bool is_open() const { return m_fd != -1; }
+
+		// Serves clients forever. `handler` is called for every line and
+		// returns an error message, or empty string on success.
+		void run(const std::function<std::string(std::string_view)>& handler);
+
+	private:
+		int			m_fd = -1;
+		std::string	m_path;
+	};
+
+}
\ No newline at end of file
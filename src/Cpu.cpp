@@ -0,0 +1,63 @@
+#include "Cpu.h"
+
+#include "Common.h"
+#include "Sampler.h"
+
+#include <iostream>
+
+namespace bsbar
+{
+
+	bool CpuBlock::add_custom_config(std::string_view key, toml::node& value)
+	{
+		if (key == "core")
+		{
+			BSBAR_VERIFY_TYPE(value, integer, key);
+			int64_t core = **value.as_integer();
+			if (core < 0)
+			{
+				std::cerr << "Value for key 'core' must be non-negative integer" << std::endl;
+				std::cerr << "  " << value.source() << std::endl;
+				exit(1);
+			}
+			m_key = "cpu" + std::to_string(core);
+			return true;
+		}
+
+		return false;
+	}
+
+	bool CpuBlock::custom_update(time_point tp)
+	{
+		auto stat = Sampler::get(Sampler::Source::Stat, tp);
+		if (!stat)
+			return false;
+
+		// user nice system idle iowait irq softirq steal ...
+		auto line = stat->find(m_key);
+		if (!line || line->count < 5)
+			return false;
+
+		double total = 0.0;
+		for (std::size_t i = 0; i < std::min<std::size_t>(line->count, 8); i++)
+			total += line->values[i];
+		double idle = line->values[3] + line->values[4];
+
+		double delta_total	= total - m_last_total;
+		double delta_idle	= idle - m_last_idle;
+		m_last_total	= total;
+		m_last_idle		= idle;
+
+		// First sample has nothing to compare to, its delta would be the average since boot
+		if (!std::exchange(m_has_last, true))
+			return false;
+
+		std::scoped_lock _(m_mutex);
+
+		m_value.value = delta_total > 0.0 ? (delta_total - delta_idle) / delta_total * 100.0 : 0.0;
+		m_text = m_format;
+
+		return true;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Block.h"
+
+namespace bsbar
+{
+
+	class CpuBlock : public Block
+	{
+	public:
+		virtual bool add_custom_config(std::string_view key, toml::node& value) override;
+		virtual bool custom_update(time_point tp) override;
+
+	private:
+		std::string		m_key			= "cpu";
+		double			m_last_total	= 0.0;
+		double			m_last_idle		= 0.0;
+		bool			m_has_last		= false;
+	};
+
+}
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "Common.h"
 
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 
 namespace bsbar
@@ -26,15 +28,76 @@ namespace bsbar
 		return false;
 	}
 
+	// Pushed text is copied into full_text verbatim, so it must be a valid JSON string body.
+	// '%' is escaped too, which keeps placeholders such as %text% out of the substituted text.
+	static std::string escape_pushed_text(std::string_view data)
+	{
+		std::string out;
+		out.reserve(data.size());
+		for (char c : data)
+		{
+			switch (c)
+			{
+				case '"':	out += "\\\"";	break;
+				case '\\':	out += "\\\\";	break;
+				case '%':	out += "\\u0025";	break;
+				default:
+					if ((unsigned char)c < 0x20)
+					{
+						char buffer[8];
+						std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+						out += buffer;
+					}
+					else
+						out += c;
+					break;
+			}
+		}
+		return out;
+	}
+
+	bool CustomBlock::custom_set_data(std::string_view key, std::string_view data)
+	{
+		if (key == "text")
+		{
+			std::string text = escape_pushed_text(data);
+			std::scoped_lock _(m_mutex);
+			m_pushed_text = std::move(text);
+			return true;
+		}
+
+		if (key == "value")
+		{
+			double value;
+			if (!string_to_value(data, value))
+				return false;
+			std::scoped_lock _(m_mutex);
+			m_pushed_value = value;
+			return true;
+		}
+
+		return false;
+	}
+
 	bool CustomBlock::custom_update(time_point)
 	{
-		std::string_view text;
+		std::string text;
 
 		constexpr double nan = std::numeric_limits<double>::quiet_NaN();
 
 		double value = nan;
 
-		if (!m_text_command.empty())
+		std::optional<std::string> pushed_text;
+		std::optional<double> pushed_value;
+		{
+			std::scoped_lock _(m_mutex);
+			pushed_text = m_pushed_text;
+			pushed_value = m_pushed_value;
+		}
+
+		if (pushed_text)
+			text = std::move(*pushed_text);
+		else if (!m_text_command.empty())
 		{
 			FILE* fp = popen(m_text_command.c_str(), "r");
 			if (fp == NULL)
@@ -52,7 +115,9 @@ namespace bsbar
 			text = text.substr(0, text.find('\n'));
 		}
 
-		if (!m_value_command.empty())
+		if (pushed_value)
+			value = *pushed_value;
+		else if (!m_value_command.empty())
 		{
 			FILE* fp = popen(m_value_command.c_str(), "r");
 			if (fp == NULL)
@@ -72,7 +137,7 @@ namespace bsbar
 
 		std::scoped_lock _(m_mutex);
 
-		if (value != nan)
+		if (!std::isnan(value))
 			m_value.value = value;
 
 		m_text = m_format;
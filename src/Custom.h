@@ -10,10 +10,17 @@ namespace bsbar
 	public:
 		virtual bool add_custom_config(std::string_view key, toml::node& value) override;
 		virtual bool custom_update(time_point) override;
+		virtual bool custom_is_expensive() const override { return !m_text_command.empty() || !m_value_command.empty(); }
+
+		virtual bool custom_set_data(std::string_view key, std::string_view data) override;
 
 	private:
 		std::string m_text_command;
 		std::string m_value_command;
+
+		// Set through control socket, used instead of the commands
+		std::optional<std::string>	m_pushed_text;
+		std::optional<double>		m_pushed_value;
 	};
 
 }
\ No newline at end of file
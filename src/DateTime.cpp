@@ -5,17 +5,93 @@
 namespace bsbar
 {
 
+	void DateTimeBlock::custom_initialize()
+	{
+		// localtime_r() is not required to read TZ, so the timezone is loaded once here
+		static std::once_flag tz_once;
+		std::call_once(tz_once, tzset);
+	}
+
+	void DateTimeBlock::custom_config_done()
+	{
+		for (std::size_t i = 0; i + 1 < m_format.size(); i++)
+		{
+			if (m_format[i] != '%')
+				continue;
+
+			char c = m_format[++i];
+			// E and O modifiers (e.g. %OS) select alternative representations of the same field
+			if ((c == 'E' || c == 'O') && i + 1 < m_format.size())
+				c = m_format[++i];
+
+			if (c >= '1' && c <= '3' && i + 1 < m_format.size() && m_format[i + 1] == 'f')
+				m_fraction_digits = std::max(m_fraction_digits, c - '0');
+			else if (c == 'f')
+				m_fraction_digits = 3;
+
+			// Specifiers that show seconds, everything else changes at most once a minute
+			if (std::string_view("STrcsX+").find(c) != std::string_view::npos)
+				m_granularity = std::min<std::chrono::milliseconds>(m_granularity, std::chrono::seconds(1));
+		}
+
+		static constexpr int64_t fraction_granularity[] = { 1000, 100, 10, 1 };
+		if (m_fraction_digits > 0)
+			m_granularity = std::chrono::milliseconds(fraction_granularity[m_fraction_digits]);
+
+		if (!m_interval)
+			m_interval = m_granularity;
+	}
+
 	bool DateTimeBlock::custom_update(time_point tp)
 	{
-		char buffer[128];
-	
-		std::time_t t = std::chrono::system_clock::to_time_t(tp);
-		if (!std::strftime(buffer, sizeof(buffer), m_format.c_str(), std::localtime(&t)))
+		auto ms = std::chrono::floor<std::chrono::milliseconds>(tp.time_since_epoch());
+
+		auto key = ms / m_granularity;
+		if (m_last_rendered == key)
+			return true;
+
+		// %f has to be substituted before strftime() as it is not a standard specifier
+		std::string format;
+		format.reserve(m_format.size());
+		for (std::size_t i = 0; i < m_format.size(); i++)
+		{
+			if (m_format[i] != '%' || i + 1 == m_format.size())
+			{
+				format += m_format[i];
+				continue;
+			}
+
+			int digits = 0;
+			if (m_format[i + 1] == 'f')
+				digits = 3, i += 1;
+			else if (m_format[i + 1] >= '1' && m_format[i + 1] <= '3' && i + 2 < m_format.size() && m_format[i + 2] == 'f')
+				digits = m_format[i + 1] - '0', i += 2;
+			else
+			{
+				format += m_format[i];
+				format += m_format[++i];
+				continue;
+			}
+
+			// Milliseconds are non-negative also before the epoch, as the seconds are floored
+			int millis = (ms.count() % 1000 + 1000) % 1000;
+			char fraction[3] = { (char)('0' + millis / 100), (char)('0' + millis / 10 % 10), (char)('0' + millis % 10) };
+			format.append(fraction, digits);
+		}
+
+		std::time_t t = std::chrono::floor<std::chrono::seconds>(ms).count();
+		std::tm tm;
+		if (!localtime_r(&t, &tm))
+			return false;
+
+		char buffer[256];
+		if (!std::strftime(buffer, sizeof(buffer), format.c_str(), &tm))
 			return false;
 
 		std::scoped_lock _(m_mutex);
-		
+
 		m_text = buffer;
+		m_last_rendered = key;
 		return true;
 	}
 
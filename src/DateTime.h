@@ -4,6 +4,7 @@
 
 /*
 see https://en.cppreference.com/w/cpp/chrono/c/strftime for formatting
+%f, %1f, %2f, %3f are replaced with fractional seconds of given number of digits (3 by default)
 */
 
 namespace bsbar
@@ -12,8 +13,19 @@ namespace bsbar
 	class DateTimeBlock : public Block
 	{
 	public:
+		virtual void custom_initialize() override;
+
+		virtual void custom_config_done() override;
+
 		virtual bool custom_update(time_point tp) override;
 
+	private:
+		// Smallest unit of time shown by the format. Text is re-rendered only when
+		// time point truncated to this granularity changes.
+		std::chrono::milliseconds	m_granularity	= std::chrono::minutes(1);
+		int							m_fraction_digits = 0;
+
+		std::optional<std::chrono::milliseconds::rep>	m_last_rendered;
 	};
 
 }
\ No newline at end of file
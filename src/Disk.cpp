@@ -0,0 +1,356 @@
+#include "Disk.h"
+
+#include "Common.h"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+namespace bsbar
+{
+
+	// Paths that do not exist yet (e.g. mount points created by udisks) are only normalized
+	static std::string resolve_mount_path(const std::string& path)
+	{
+		if (char* resolved = realpath(path.c_str(), nullptr))
+		{
+			std::string result = resolved;
+			free(resolved);
+			return result;
+		}
+
+		std::string result = std::filesystem::path(path).lexically_normal().string();
+		while (result.size() > 1 && result.back() == '/')
+			result.pop_back();
+		return result;
+	}
+
+	DiskBlock::Mount::Mount(std::string path)
+		: path(std::move(path))
+		, resolved_path(resolve_mount_path(this->path))
+	{ }
+
+	DiskBlock::~DiskBlock()
+	{
+		custom_stop();
+	}
+
+	void DiskBlock::custom_stop()
+	{
+		if (m_watcher_thread.joinable())
+		{
+			uint64_t one = 1;
+			write(m_wake_fd, &one, sizeof(one));
+			m_watcher_thread.join();
+		}
+
+		if (m_mountinfo_fd != -1)
+			close(std::exchange(m_mountinfo_fd, -1));
+		if (m_wake_fd != -1)
+			close(std::exchange(m_wake_fd, -1));
+
+		// Workers may be stuck in statvfs() of a hung mount. They own a reference
+		// to their mount and exit once the call returns.
+		for (auto& mount : m_mounts)
+		{
+			std::scoped_lock _(mount->mutex);
+			mount->stop = true;
+			mount->cv.notify_all();
+		}
+	}
+
+	void DiskBlock::custom_initialize()
+	{
+		for (auto& mount : m_mounts)
+		{
+			// Worker of the previous custom_stop() may still be in statvfs(), it keeps the old mount
+			if (mount->stop)
+				mount = std::make_shared<Mount>(mount->path);
+			std::thread(&DiskBlock::mount_worker, mount).detach();
+		}
+
+		std::string mountinfo_path = system_path("/proc/self/mountinfo");
+		m_mountinfo_fd = open(mountinfo_path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (m_mountinfo_fd == -1)
+		{
+			std::cerr << "open(\"" << mountinfo_path << "\")\n  " << strerror(errno) << std::endl;
+			return;
+		}
+
+		resolve_mounts();
+
+		m_wake_fd = eventfd(0, EFD_CLOEXEC);
+		if (m_wake_fd == -1)
+		{
+			std::cerr << "eventfd()\n  " << strerror(errno) << std::endl;
+			return;
+		}
+
+		m_watcher_thread = std::thread(&DiskBlock::mount_watcher_thread, this);
+	}
+
+	void DiskBlock::custom_config_done()
+	{
+		if (m_mounts.empty())
+			m_mounts.push_back(std::make_shared<Mount>("/"));
+	}
+
+	bool DiskBlock::add_custom_config(std::string_view key, toml::node& value)
+	{
+		if (key == "mount")
+		{
+			m_mounts.clear();
+			if (value.is_string())
+				m_mounts.push_back(std::make_shared<Mount>(**value.as_string()));
+			else if (value.is_array())
+			{
+				for (auto&& elem : *value.as_array())
+				{
+					BSBAR_VERIFY_TYPE_CUSTOM_MESSAGE(elem, string, "value for key 'mount' must be a string or an array of strings");
+					m_mounts.push_back(std::make_shared<Mount>(**elem.as_string()));
+				}
+			}
+			else
+			{
+				std::cerr << "value for key 'mount' must be a string or an array of strings" << std::endl;
+				std::cerr << "  " << value.source() << std::endl;
+				exit(1);
+			}
+			return true;
+		}
+
+		if (key == "format-stale")
+		{
+			BSBAR_VERIFY_TYPE(value, string, key);
+			m_format_stale = **value.as_string();
+			return true;
+		}
+
+		if (key == "format-unmounted")
+		{
+			BSBAR_VERIFY_TYPE(value, string, key);
+			m_format_unmounted = **value.as_string();
+			return true;
+		}
+
+		if (key == "mount-separator")
+		{
+			BSBAR_VERIFY_TYPE(value, string, key);
+			m_mount_separator = **value.as_string();
+			return true;
+		}
+
+		if (key == "size-precision")
+		{
+			BSBAR_VERIFY_TYPE(value, integer, key);
+			m_size_precision = **value.as_integer();
+			return true;
+		}
+
+		if (key == "timeout")
+		{
+			BSBAR_VERIFY_TYPE(value, integer, key);
+			int64_t timeout = **value.as_integer();
+			if (timeout <= 0)
+			{
+				std::cerr << "Value for key 'timeout' must be positive integer" << std::endl;
+				std::cerr << "  " << value.source() << std::endl;
+				exit(1);
+			}
+			m_timeout = std::chrono::milliseconds(timeout);
+			return true;
+		}
+
+		return false;
+	}
+
+	void DiskBlock::mount_worker(std::shared_ptr<Mount> mount)
+	{
+		std::unique_lock lock(mount->mutex);
+		while (true)
+		{
+			mount->cv.wait(lock, [&]() { return mount->requested || mount->stop; });
+			if (mount->stop)
+				return;
+
+			mount->requested = false;
+			mount->busy = true;
+			lock.unlock();
+
+			struct statvfs buf;
+			bool success = statvfs(mount->path.c_str(), &buf) == 0;
+
+			lock.lock();
+			mount->busy = false;
+			mount->done = true;
+			mount->success = success;
+			if (success)
+			{
+				mount->total		= (uint64_t)buf.f_blocks * buf.f_frsize;
+				mount->free			= (uint64_t)buf.f_bfree  * buf.f_frsize;
+				mount->available	= (uint64_t)buf.f_bavail * buf.f_frsize;
+			}
+			mount->cv.notify_all();
+		}
+	}
+
+	// Decodes octal escapes (\040 etc.) used in /proc/self/mountinfo
+	static std::string unescape_mount_point(std::string_view sv)
+	{
+		std::string result;
+		for (std::size_t i = 0; i < sv.size(); i++)
+		{
+			if (sv[i] == '\\' && i + 3 < sv.size())
+			{
+				int value = 0;
+				if (std::from_chars(sv.data() + i + 1, sv.data() + i + 4, value, 8).ec == std::errc())
+				{
+					result.push_back((char)value);
+					i += 3;
+					continue;
+				}
+			}
+			result.push_back(sv[i]);
+		}
+		return result;
+	}
+
+	void DiskBlock::resolve_mounts()
+	{
+		std::string data;
+
+		char buffer[4096];
+		ssize_t nread;
+		off_t offset = 0;
+		while ((nread = pread(m_mountinfo_fd, buffer, sizeof(buffer), offset)) > 0)
+		{
+			data.append(buffer, nread);
+			offset += nread;
+		}
+
+		std::unordered_set<std::string> mount_points;
+		for (auto line : split(data, '\n'))
+		{
+			auto fields = split(line, ' ');
+			if (fields.size() > 4)
+				mount_points.insert(unescape_mount_point(fields[4]));
+		}
+
+		// Path below a mount point other than / counts as mounted, e.g. /mnt/usb/photos is
+		// mounted while /mnt/usb is
+		for (auto& mount : m_mounts)
+		{
+			std::string_view path = mount->resolved_path;
+			bool mounted = mount_points.contains(std::string(path));
+			for (auto slash = path.rfind('/'); !mounted && slash != std::string_view::npos && slash > 0; slash = path.rfind('/', slash - 1))
+				mounted = mount_points.contains(std::string(path.substr(0, slash)));
+			mount->mounted = mounted;
+		}
+	}
+
+	void DiskBlock::mount_watcher_thread()
+	{
+		pollfd fds[2] {};
+		fds[0].fd = m_mountinfo_fd;
+		fds[0].events = POLLPRI;
+		fds[1].fd = m_wake_fd;
+		fds[1].events = POLLIN;
+
+		while (true)
+		{
+			if (poll(fds, 2, -1) == -1)
+			{
+				if (errno == EINTR)
+					continue;
+				std::cerr << "poll()\n  " << strerror(errno) << std::endl;
+				return;
+			}
+
+			if (fds[1].revents)
+				return;
+
+			// Kernel signals mount table changes with POLLPRI | POLLERR
+			if (fds[0].revents & (POLLPRI | POLLERR))
+			{
+				resolve_mounts();
+				request_update(false);
+			}
+		}
+	}
+
+	bool DiskBlock::custom_update(time_point)
+	{
+		auto deadline = std::chrono::steady_clock::now() + m_timeout;
+
+		// Mounts whose previous statvfs() has not returned yet are not queried again
+		std::vector<bool> queried(m_mounts.size(), false);
+		for (std::size_t i = 0; i < m_mounts.size(); i++)
+		{
+			auto& mount = m_mounts[i];
+			if (!mount->mounted && m_format_unmounted)
+				continue;
+
+			std::scoped_lock _(mount->mutex);
+			if (mount->busy)
+				continue;
+			mount->done = false;
+			mount->requested = true;
+			mount->cv.notify_all();
+			queried[i] = true;
+		}
+
+		std::string text;
+		double max_usage = 0.0;
+
+		for (std::size_t i = 0; i < m_mounts.size(); i++)
+		{
+			auto& mount = m_mounts[i];
+
+			if (!text.empty())
+				text += m_mount_separator;
+
+			std::string mount_text;
+
+			if (!mount->mounted && m_format_unmounted)
+				mount_text = *m_format_unmounted;
+			else if (!queried[i])
+				mount_text = m_format_stale;
+			else
+			{
+				std::unique_lock lock(mount->mutex);
+
+				// Mount that did not respond in time is marked stale
+				if (!mount->cv.wait_until(lock, deadline, [&]() { return mount->done; }) || !mount->success)
+					mount_text = m_format_stale;
+				else
+				{
+					uint64_t used = mount->total - mount->free;
+					double usage = (used + mount->available) ? (double)used / (used + mount->available) * 100.0 : 0.0;
+					max_usage = std::max(max_usage, usage);
+
+					mount_text = m_format;
+					replace_all(mount_text, "%used%",	bytes_to_string(used, m_size_precision));
+					replace_all(mount_text, "%free%",	bytes_to_string(mount->available, m_size_precision));
+					replace_all(mount_text, "%total%",	bytes_to_string(mount->total, m_size_precision));
+					replace_all(mount_text, "%value%",	value_to_string(usage, m_value.precision));
+				}
+			}
+
+			replace_all(mount_text, "%mount%", mount->path);
+			text += mount_text;
+		}
+
+		std::scoped_lock _(m_mutex);
+
+		m_value.value = max_usage;
+		m_text = std::move(text);
+
+		return true;
+	}
+
+}
\ No newline at end of file
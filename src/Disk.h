@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Block.h"
+
+namespace bsbar
+{
+
+	class DiskBlock : public Block
+	{
+	public:
+		virtual ~DiskBlock();
+
+		virtual void custom_initialize() override;
+		virtual void custom_stop() override;
+
+		virtual void custom_config_done() override;
+
+		virtual bool add_custom_config(std::string_view key, toml::node& value) override;
+		virtual bool custom_update(time_point) override;
+
+	private:
+		// statvfs() is done on a worker thread per mount so an unresponsive
+		// mount (e.g. hung NFS) only marks that mount stale
+		struct Mount
+		{
+			Mount(std::string path);
+
+			std::string				path;
+			// `path` with symlinks, "." and trailing slashes resolved, compared to mountinfo
+			std::string				resolved_path;
+			std::atomic<bool>		mounted		= true;
+
+			bool					requested	= false;
+			bool					busy		= false;
+			bool					done		= false;
+			bool					success		= false;
+			bool					stop		= false;
+			uint64_t				total		= 0;
+			uint64_t				free		= 0;
+			uint64_t				available	= 0;
+			std::mutex				mutex;
+			std::condition_variable	cv;
+		};
+
+	private:
+		static void mount_worker(std::shared_ptr<Mount> mount);
+
+		void resolve_mounts();
+		void mount_watcher_thread();
+
+	private:
+		std::vector<std::shared_ptr<Mount>>	m_mounts;
+
+		std::string							m_format_stale		= "%mount% ?";
+		std::optional<std::string>			m_format_unmounted;
+		std::string							m_mount_separator	= " ";
+		std::chrono::milliseconds			m_timeout			= std::chrono::milliseconds(500);
+		int									m_size_precision	= 1;
+
+		int									m_mountinfo_fd		= -1;
+		int									m_wake_fd			= -1;
+		std::thread							m_watcher_thread;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "Histogram.h"
+
+#include <algorithm>
+
+namespace bsbar
+{
+
+	uint64_t Histogram::bucket_upper_bound(uint32_t index)
+	{
+		if (index < s_sub_count)
+			return index;
+		uint32_t group	= index / s_sub_count;
+		uint32_t sub	= index % s_sub_count;
+		uint64_t lower	= (uint64_t)(s_sub_count + sub) << (group - 1);
+		return lower + ((uint64_t)1 << (group - 1)) - 1;
+	}
+
+	Histogram::Summary Histogram::summarize() const
+	{
+		std::array<uint64_t, s_bucket_count> counts;
+		Summary summary;
+
+		for (uint32_t i = 0; i < s_bucket_count; i++)
+		{
+			counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+			summary.count += counts[i];
+		}
+		if (summary.count == 0)
+			return summary;
+
+		uint64_t max = m_max.load(std::memory_order_relaxed);
+		summary.max = duration(max);
+
+		// Percentile is the upper bound of the bucket containing it, but never above maximum
+		auto percentile = [&](double fraction) {
+			uint64_t target = std::max<uint64_t>(1, (uint64_t)(summary.count * fraction + 0.5));
+			uint64_t seen = 0;
+			for (uint32_t i = 0; i < s_bucket_count; i++)
+			{
+				seen += counts[i];
+				if (seen >= target)
+					return duration(std::min(bucket_upper_bound(i), max));
+			}
+			return summary.max;
+		};
+
+		summary.p50 = percentile(0.50);
+		summary.p99 = percentile(0.99);
+
+		return summary;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace bsbar
+{
+
+	// Lock-free histogram of durations. Every power of two is split into 8 linear buckets,
+	// so percentiles are within 12.5% of the recorded values. Recording does not allocate.
+	class Histogram
+	{
+	public:
+		using duration = std::chrono::nanoseconds;
+
+		struct Summary
+		{
+			uint64_t	count	= 0;
+			duration	p50		= {};
+			duration	p99		= {};
+			duration	max		= {};
+		};
+
+	public:
+		void record(duration value)
+		{
+			uint64_t ns = value.count() > 0 ? value.count() : 0;
+			m_buckets[bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+
+			uint64_t max = m_max.load(std::memory_order_relaxed);
+			while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+				continue;
+		}
+
+		// Concurrent records may or may not be included
+		Summary summarize() const;
+
+	private:
+		static constexpr uint32_t s_sub_bits		= 3;
+		static constexpr uint32_t s_sub_count		= 1 << s_sub_bits;
+		// Values above 2^40 ns (about 18 minutes) share the last bucket
+		static constexpr uint32_t s_max_exponent	= 40;
+		static constexpr uint32_t s_bucket_count	= (s_max_exponent - s_sub_bits + 2) * s_sub_count;
+
+		static constexpr uint32_t bucket_index(uint64_t ns)
+		{
+			if (ns < s_sub_count)
+				return ns;
+			uint32_t exponent = 63 - std::countl_zero(ns);
+			if (exponent > s_max_exponent)
+				return s_bucket_count - 1;
+			uint32_t sub = (ns >> (exponent - s_sub_bits)) & (s_sub_count - 1);
+			return (exponent - s_sub_bits + 1) * s_sub_count + sub;
+		}
+
+		// Largest value that maps to bucket `index`
+		static uint64_t bucket_upper_bound(uint32_t index);
+
+	private:
+		std::array<std::atomic<uint64_t>, s_bucket_count>	m_buckets {};
+		std::atomic<uint64_t>								m_max = 0;
+	};
+
+	// std::mutex that records time spent waiting for the lock. Uncontended
+	// locks are recorded as zero without reading the clock.
+	class TimedMutex
+	{
+	public:
+		explicit TimedMutex(Histogram& wait) : m_wait(wait) {}
+
+		void lock()
+		{
+			if (m_mutex.try_lock())
+			{
+				m_wait.record(Histogram::duration::zero());
+				return;
+			}
+			auto start = std::chrono::steady_clock::now();
+			m_mutex.lock();
+			m_wait.record(std::chrono::steady_clock::now() - start);
+		}
+
+		bool try_lock()	{ return m_mutex.try_lock(); }
+		void unlock()	{ m_mutex.unlock(); }
+
+	private:
+		std::mutex	m_mutex;
+		Histogram&	m_wait;
+	};
+
+}
\ No newline at end of file
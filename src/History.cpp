@@ -0,0 +1,74 @@
+#include "History.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace bsbar
+{
+
+	// ▁ to █ are U+2581 to U+2588, in UTF-8 they differ only by the last byte
+	static constexpr std::size_t s_glyph_size = 3;
+
+	History::History(std::size_t capacity, double min, double max, bool autoscale)
+		: m_capacity(capacity)
+		, m_min(min)
+		, m_max(max)
+		, m_autoscale(autoscale)
+	{
+		m_sparkline.resize(2 * m_capacity * s_glyph_size);
+		if (m_autoscale)
+			m_history.resize(2 * m_capacity * s_glyph_size);
+	}
+
+	void History::write_glyph(std::string& buffer, std::size_t index, double value, double min, double max)
+	{
+		double level = max > min ? (value - min) / (max - min) * 8.0 : 0.0;
+		int glyph = !(level > 0.0) ? 0 : std::min<int>(level, 7);
+
+		const char bytes[s_glyph_size] = { '\xe2', '\x96', (char)(0x81 + glyph) };
+
+		std::size_t capacity = buffer.size() / (2 * s_glyph_size);
+		std::memcpy(&buffer[index * s_glyph_size], bytes, s_glyph_size);
+		std::memcpy(&buffer[(index + capacity) * s_glyph_size], bytes, s_glyph_size);
+	}
+
+	std::string_view History::view(const std::string& buffer) const
+	{
+		if (buffer.empty())
+			return {};
+		// Newest glyph is the copy just before m_next + m_capacity
+		std::size_t end = m_next + m_capacity;
+		return std::string_view(buffer).substr((end - m_count) * s_glyph_size, m_count * s_glyph_size);
+	}
+
+	void History::push(double value)
+	{
+		std::size_t index = m_next;
+		m_values[index] = value;
+		m_next	= (m_next + 1) % m_capacity;
+		m_count	= std::min(m_count + 1, m_capacity);
+
+		write_glyph(m_sparkline, index, value, m_min, m_max);
+
+		if (!m_autoscale)
+			return;
+
+		// Values fill the ring from index 0, so the first m_count are in use
+		auto [min, max] = std::minmax_element(m_values, m_values + m_count);
+		if (*min == m_history_min && *max == m_history_max)
+			write_glyph(m_history, index, m_values[index], m_history_min, m_history_max);
+		else
+		{
+			m_history_min = *min;
+			m_history_max = *max;
+			rebuild_history();
+		}
+	}
+
+	void History::rebuild_history()
+	{
+		for (std::size_t i = 0; i < m_count; i++)
+			write_glyph(m_history, i, m_values[i], m_history_min, m_history_max);
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace bsbar
+{
+
+	// Last values of a block and their sparklines (▁▂▃▄▅▆▇█). Every glyph is stored twice, at
+	// position i and i + capacity, so the newest `capacity` glyphs always form one contiguous
+	// view. Adding a sample writes a single glyph instead of rebuilding the string.
+	class History
+	{
+	public:
+		static constexpr std::size_t max_capacity = 32;
+
+	public:
+		// `capacity` must be between 1 and max_capacity
+		History(std::size_t capacity, double min, double max, bool autoscale);
+
+		void push(double value);
+
+		// Scaled to the range given in constructor
+		std::string_view sparkline() const	{ return view(m_sparkline); }
+		// Scaled to the smallest and largest value in history. Empty unless `autoscale`.
+		std::string_view history() const	{ return view(m_history); }
+
+	private:
+		static void write_glyph(std::string& buffer, std::size_t index, double value, double min, double max);
+		std::string_view view(const std::string& buffer) const;
+		void rebuild_history();
+
+	private:
+		std::size_t		m_capacity;
+		std::size_t		m_count		= 0;
+		std::size_t		m_next		= 0;
+		double			m_min;
+		double			m_max;
+
+		// Autoscaled sparkline is rebuilt only when the range of stored values changes
+		bool			m_autoscale;
+		float			m_values[max_capacity];
+		float			m_history_min	= 0.0f;
+		float			m_history_max	= 0.0f;
+
+		std::string		m_sparkline;
+		std::string		m_history;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "I3bar.h"
+
+#include <nlohmann/json.hpp>
+
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace bsbar
+{
+
+	static bool parse_mouse_info(const nlohmann::json& json, Block::MouseInfo& out)
+	{
+		if (!json.contains("button") || !json["button"].is_number())
+			return false;
+
+		switch ((int)json["button"])
+		{
+			case 1: out.type = Block::MouseType::Left;			break;
+			case 2: out.type = Block::MouseType::Middle;		break;
+			case 3: out.type = Block::MouseType::Right;			break;
+			case 4: out.type = Block::MouseType::ScrollUp;		break;
+			case 5: out.type = Block::MouseType::ScrollDown;	break;
+			default:
+				return false;
+		}
+
+		if (!json.contains("relative_x") || !json["relative_x"].is_number())
+			return false;
+		out.pos[0] = json["relative_x"];
+
+		if (!json.contains("relative_y") || !json["relative_y"].is_number())
+			return false;
+		out.pos[1] = json["relative_y"];
+
+		if (!json.contains("width") || !json["width"].is_number())
+			return false;
+		out.size[0] = json["width"];
+
+		if (!json.contains("height") || !json["height"].is_number())
+			return false;
+		out.size[1] = json["height"];
+
+		return true;
+	}
+
+	bool parse_click_event(std::string_view line_sv, ClickEvent& out)
+	{
+		if (!line_sv.empty() && line_sv.front() == ',')
+			line_sv = line_sv.substr(1);
+
+		nlohmann::json json;
+		try {
+			json = nlohmann::json::parse(line_sv);
+		} catch(...) {
+			return false;
+		}
+
+		if (!json.contains("name") || !json.contains("instance"))
+			return false;
+		if (!json["name"].is_string() || !json["instance"].is_string())
+			return false;
+
+		out.instance = json["instance"];
+		out.sub.clear();
+
+		if (auto pos = out.instance.find('.'); pos != std::string::npos)
+		{
+			out.sub			= out.instance.substr(pos + 1);
+			out.instance	= out.instance.substr(0, pos);
+		}
+
+		return parse_mouse_info(json, out.mouse);
+	}
+
+	bool is_scroll(const ClickEvent& event)
+	{
+		return event.mouse.type == Block::MouseType::ScrollUp || event.mouse.type == Block::MouseType::ScrollDown;
+	}
+
+	const std::string& protocol_header()
+	{
+		// i3bar sends these instead of SIGSTOP/SIGCONT when the bar is hidden and shown
+		static const std::string header =
+			"{\"version\":1,\"click_events\":true"
+			",\"stop_signal\":" + std::to_string(SIGTSTP) +
+			",\"cont_signal\":" + std::to_string(SIGCONT) + "}\n[\n";
+		return header;
+	}
+
+	void render_frame(const std::vector<std::unique_ptr<Block>>& blocks, std::string& out)
+	{
+		bool first_block = true;
+		out += '[';
+		for (const auto& block : blocks)
+		{
+			if (!first_block)
+				out += ',';
+			block->print(out);
+			first_block = false;
+		}
+		out += "],\n";
+	}
+
+	FrameWriter::FrameWriter(int fd, std::string header)
+		: m_fd(fd)
+		, m_header(std::move(header))
+	{
+		// Terminals and files are left blocking, since their file description is often shared with stderr
+		struct stat st;
+		if (fstat(m_fd, &st) == 0 && (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode)))
+			fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+
+		m_thread = std::thread(&FrameWriter::writer_thread, this);
+	}
+
+	FrameWriter::~FrameWriter()
+	{
+		{
+			std::scoped_lock _(m_mutex);
+			m_stop = true;
+			m_cv.notify_all();
+		}
+		m_thread.join();
+	}
+
+	void FrameWriter::submit(std::string frame)
+	{
+		std::scoped_lock _(m_mutex);
+		if (m_waiting)
+			m_stats.dropped++;
+		m_waiting = std::move(frame);
+		m_cv.notify_all();
+	}
+
+	void FrameWriter::flush()
+	{
+		std::unique_lock lock(m_mutex);
+		m_idle_cv.wait(lock, [this]() { return !m_waiting && !m_writing; });
+	}
+
+	FrameWriter::Stats FrameWriter::get_stats() const
+	{
+		std::scoped_lock _(m_mutex);
+		return m_stats;
+	}
+
+	// Frame is written to the end even if newer frames arrive meanwhile,
+	// since i3bar can't parse a partial frame
+	bool FrameWriter::write_all(std::string_view data)
+	{
+		std::size_t offset = 0;
+		while (offset < data.size())
+		{
+			ssize_t nwrite = write(m_fd, data.data() + offset, data.size() - offset);
+			if (nwrite > 0)
+			{
+				offset += nwrite;
+				if (offset < data.size())
+				{
+					std::scoped_lock _(m_mutex);
+					m_stats.partial_writes++;
+				}
+				continue;
+			}
+
+			if (nwrite == -1 && errno == EINTR)
+				continue;
+
+			if (nwrite == -1 && errno == EAGAIN)
+			{
+				pollfd pfd { .fd = m_fd, .events = POLLOUT, .revents = 0 };
+				poll(&pfd, 1, -1);
+				continue;
+			}
+
+			std::cerr << "write()\n  " << strerror(errno) << std::endl;
+			return false;
+		}
+
+		return true;
+	}
+
+	void FrameWriter::writer_thread()
+	{
+		// Header is written separately from frames, so dropping a frame can't drop it
+		write_all(m_header);
+
+		std::string frame;
+
+		std::unique_lock lock(m_mutex);
+		m_writing = false;
+		m_idle_cv.notify_all();
+		while (true)
+		{
+			m_cv.wait(lock, [this]() { return m_stop || m_waiting; });
+			if (!m_waiting)
+				return;
+
+			frame = std::move(*m_waiting);
+			m_waiting.reset();
+			m_writing = true;
+
+			lock.unlock();
+			bool success = write_all(frame);
+			lock.lock();
+
+			m_writing = false;
+			if (success)
+				m_stats.written++;
+			m_idle_cv.notify_all();
+		}
+	}
+
+}
\ No newline at end of file
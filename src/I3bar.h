@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Block.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace bsbar
+{
+
+	// Click event read from i3bar. Instance "menu.sub1" is split to instance "menu" and sub "sub1".
+	struct ClickEvent
+	{
+		std::string				instance;
+		std::string				sub;
+		Block::MouseInfo		mouse;
+	};
+
+	// Parses one line of the click event stream. Leading comma of the infinite array is allowed.
+	bool parse_click_event(std::string_view line_sv, ClickEvent& out);
+
+	bool is_scroll(const ClickEvent& event);
+
+	// Protocol header followed by the opening bracket of the infinite array of status lines
+	const std::string& protocol_header();
+
+	// Appends one status line of blocks to `out`. Every line ends with a comma, so
+	// any of them can be dropped without breaking the array.
+	void render_frame(const std::vector<std::unique_ptr<Block>>& blocks, std::string& out);
+
+	// Writes frames to `fd` on its own thread, so callers never block on a full pipe (e.g. i3bar not
+	// reading while i3 reloads). At most one frame waits behind the one being written. Newer frames
+	// replace the waiting one, and a frame is always written completely, so the stream stays valid JSON.
+	class FrameWriter
+	{
+	public:
+		struct Stats
+		{
+			uint64_t	written			= 0;
+			uint64_t	dropped			= 0;
+			uint64_t	partial_writes	= 0;
+		};
+
+	public:
+		// `header` is written before any frame
+		FrameWriter(int fd, std::string header);
+		// Writes waiting frame before returning
+		~FrameWriter();
+
+		void submit(std::string frame);
+
+		// Blocks until every submitted frame is written or dropped
+		void flush();
+
+		Stats get_stats() const;
+
+	private:
+		void writer_thread();
+		bool write_all(std::string_view data);
+
+	private:
+		int							m_fd;
+		std::string					m_header;
+		std::optional<std::string>	m_waiting;
+		// Set until the header has been written
+		bool						m_writing	= true;
+		bool						m_stop		= false;
+		Stats						m_stats;
+
+		mutable std::mutex			m_mutex;
+		std::condition_variable		m_cv;
+		std::condition_variable		m_idle_cv;
+		std::thread					m_thread;
+	};
+
+}
\ No newline at end of file
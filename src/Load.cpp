@@ -0,0 +1,113 @@
+#include "Load.h"
+
+#include "Common.h"
+#include "Sampler.h"
+
+#include <iostream>
+
+namespace bsbar
+{
+
+	void LoadBlock::custom_config_done()
+	{
+		static constexpr std::pair<std::string_view, Quantity> placeholders[] = {
+			{ "%load1%",			Quantity::Load1				},
+			{ "%load5%",			Quantity::Load5				},
+			{ "%load15%",			Quantity::Load15			},
+			{ "%pressure-cpu%",		Quantity::PressureCpu		},
+			{ "%pressure-memory%",	Quantity::PressureMemory	},
+			{ "%pressure-io%",		Quantity::PressureIo		},
+		};
+
+		for (const auto& placeholder : placeholders)
+			if (m_format.find(placeholder.first) != std::string::npos)
+				m_placeholders.push_back(placeholder);
+	}
+
+	bool LoadBlock::add_custom_config(std::string_view key, toml::node& value)
+	{
+		if (key == "value")
+		{
+			BSBAR_VERIFY_TYPE(value, string, key);
+
+			std::string_view quantity = *value.value<std::string_view>();
+			if (quantity == "load1")
+				m_value_quantity = Quantity::Load1;
+			else if (quantity == "load5")
+				m_value_quantity = Quantity::Load5;
+			else if (quantity == "load15")
+				m_value_quantity = Quantity::Load15;
+			else if (quantity == "pressure-cpu")
+				m_value_quantity = Quantity::PressureCpu;
+			else if (quantity == "pressure-memory")
+				m_value_quantity = Quantity::PressureMemory;
+			else if (quantity == "pressure-io")
+				m_value_quantity = Quantity::PressureIo;
+			else
+			{
+				std::cerr << "unrecognized value for key '" << key << "'. valid keys are \"load1\", \"load5\", \"load15\", \"pressure-cpu\", \"pressure-memory\", \"pressure-io\"" << std::endl;
+				std::cerr << "  " << value.source() << std::endl;
+				exit(1);
+			}
+			return true;
+		}
+
+		return false;
+	}
+
+	std::optional<double> LoadBlock::get_quantity(Quantity quantity, time_point tp)
+	{
+		auto get_load = [tp](std::size_t index) -> std::optional<double>
+		{
+			auto loadavg = Sampler::get(Sampler::Source::Loadavg, tp);
+			if (!loadavg || loadavg->lines.empty() || loadavg->lines.front().count <= index)
+				return {};
+			return loadavg->lines.front().values[index];
+		};
+
+		// 'some avg10' of pressure stall information
+		auto get_pressure = [tp](Sampler::Source source) -> std::optional<double>
+		{
+			auto pressure = Sampler::get(source, tp);
+			if (!pressure)
+				return {};
+			auto line = pressure->find("some");
+			if (!line || line->count == 0)
+				return {};
+			return line->values[0];
+		};
+
+		switch (quantity)
+		{
+			case Quantity::Load1:			return get_load(0);
+			case Quantity::Load5:			return get_load(1);
+			case Quantity::Load15:			return get_load(2);
+			case Quantity::PressureCpu:		return get_pressure(Sampler::Source::PressureCpu);
+			case Quantity::PressureMemory:	return get_pressure(Sampler::Source::PressureMemory);
+			case Quantity::PressureIo:		return get_pressure(Sampler::Source::PressureIo);
+		}
+		return {};
+	}
+
+	bool LoadBlock::custom_update(time_point tp)
+	{
+		auto value = get_quantity(m_value_quantity, tp);
+		if (!value)
+			return false;
+
+		std::string text = m_format;
+		for (const auto& [placeholder, quantity] : m_placeholders)
+		{
+			auto result = get_quantity(quantity, tp);
+			replace_all(text, placeholder, result ? value_to_string(*result, 2) : "?");
+		}
+
+		std::scoped_lock _(m_mutex);
+
+		m_value.value = *value;
+		m_text = std::move(text);
+
+		return true;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Block.h"
+
+namespace bsbar
+{
+
+	class LoadBlock : public Block
+	{
+	public:
+		virtual void custom_config_done() override;
+
+		virtual bool add_custom_config(std::string_view key, toml::node& value) override;
+		virtual bool custom_update(time_point tp) override;
+
+	private:
+		enum class Quantity
+		{
+			Load1,
+			Load5,
+			Load15,
+			PressureCpu,
+			PressureMemory,
+			PressureIo,
+		};
+
+	private:
+		static std::optional<double> get_quantity(Quantity quantity, time_point tp);
+
+	private:
+		Quantity											m_value_quantity = Quantity::Load1;
+		std::vector<std::pair<std::string_view, Quantity>>	m_placeholders;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "Meminfo.h"
+
+#include "Common.h"
+
+#include <algorithm>
+
+namespace bsbar::meminfo
+{
+
+	static constexpr std::string_view s_key_names[] = {
+		"MemTotal",
+		"MemFree",
+		"MemAvailable",
+		"Cached",
+		"SReclaimable",
+		"SwapTotal",
+		"SwapFree",
+	};
+
+	bool scan(std::string_view data, uint32_t mask, uint64_t (&values)[KeyCount])
+	{
+		std::size_t pos = 0;
+		while (mask && pos < data.size())
+		{
+			std::size_t end = data.find('\n', pos);
+			if (end == std::string_view::npos)
+				end = data.size();
+
+			std::string_view line = data.substr(pos, end - pos);
+			pos = end + 1;
+
+			std::size_t colon = line.find(':');
+			if (colon == std::string_view::npos)
+				continue;
+			std::string_view name = line.substr(0, colon);
+
+			for (uint32_t key = 0; key < KeyCount; key++)
+			{
+				if (!(mask & (1u << key)) || s_key_names[key] != name)
+					continue;
+
+				std::string_view number = line.substr(colon + 1);
+				number.remove_prefix(std::min(number.find_first_not_of(' '), number.size()));
+				if (!string_to_value(number.substr(0, number.find(' ')), values[key]))
+					return false;
+
+				mask &= ~(1u << key);
+				break;
+			}
+		}
+
+		return mask == 0;
+	}
+
+}
\ No newline at end of file
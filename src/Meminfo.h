@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace bsbar::meminfo
+{
+
+	// Keys of /proc/meminfo the memory block knows about
+	enum Key : uint32_t
+	{
+		MemTotal,
+		MemFree,
+		MemAvailable,
+		Cached,
+		SReclaimable,
+		SwapTotal,
+		SwapFree,
+		KeyCount
+	};
+
+	// Scans /proc/meminfo in a single pass and stops as soon as all keys in `mask` are found.
+	// Values are in kB as reported by the kernel.
+	bool scan(std::string_view data, uint32_t mask, uint64_t (&values)[KeyCount]);
+
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "Memory.h"
+
+#include "Common.h"
+#include "Sampler.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace bsbar
+{
+
+	using namespace meminfo;
+
+	bool MemoryBlock::custom_is_valid() const
+	{
+		if (m_key_mask == 0)
+		{
+			std::cerr << "No memory placeholders or 'value' used in module '" << m_name << '\'' << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	uint32_t MemoryBlock::keys_for_quantity(Quantity quantity)
+	{
+		auto bit = [](Key key) { return 1u << key; };
+
+		switch (quantity)
+		{
+			case Quantity::Total:		return bit(MemTotal);
+			case Quantity::Used:		return bit(MemTotal) | bit(MemAvailable);
+			case Quantity::Free:		return bit(MemFree);
+			case Quantity::Available:	return bit(MemAvailable);
+			case Quantity::Cached:		return bit(Cached) | bit(SReclaimable);
+			case Quantity::SwapTotal:	return bit(SwapTotal);
+			case Quantity::SwapUsed:	return bit(SwapTotal) | bit(SwapFree);
+			case Quantity::SwapFree:	return bit(SwapFree);
+		}
+		return 0;
+	}
+
+	void MemoryBlock::custom_config_done()
+	{
+		static constexpr std::pair<std::string_view, Quantity> placeholders[] = {
+			{ "%total%",		Quantity::Total		},
+			{ "%used%",			Quantity::Used		},
+			{ "%free%",			Quantity::Free		},
+			{ "%available%",	Quantity::Available	},
+			{ "%cached%",		Quantity::Cached	},
+			{ "%swap-total%",	Quantity::SwapTotal	},
+			{ "%swap-used%",	Quantity::SwapUsed	},
+			{ "%swap-free%",	Quantity::SwapFree	},
+		};
+
+		// Only keys needed by the format are searched from /proc/meminfo
+		for (const auto& placeholder : placeholders)
+		{
+			if (m_format.find(placeholder.first) == std::string::npos)
+				continue;
+			m_placeholders.push_back(placeholder);
+			m_key_mask |= keys_for_quantity(placeholder.second);
+		}
+
+		if (!m_value_quantity && (m_format.find("%value%") != std::string::npos || m_format.find("%ramp%") != std::string::npos))
+			m_value_quantity = Quantity::Used;
+
+		if (m_value_quantity)
+		{
+			bool is_swap = (*m_value_quantity == Quantity::SwapUsed || *m_value_quantity == Quantity::SwapFree);
+			m_key_mask |= keys_for_quantity(*m_value_quantity);
+			m_key_mask |= keys_for_quantity(is_swap ? Quantity::SwapTotal : Quantity::Total);
+		}
+	}
+
+	bool MemoryBlock::add_custom_config(std::string_view key, toml::node& value)
+	{
+		if (key == "value")
+		{
+			BSBAR_VERIFY_TYPE(value, string, key);
+
+			std::string_view quantity = *value.value<std::string_view>();
+			if (quantity == "used")
+				m_value_quantity = Quantity::Used;
+			else if (quantity == "free")
+				m_value_quantity = Quantity::Free;
+			else if (quantity == "available")
+				m_value_quantity = Quantity::Available;
+			else if (quantity == "cached")
+				m_value_quantity = Quantity::Cached;
+			else if (quantity == "swap-used")
+				m_value_quantity = Quantity::SwapUsed;
+			else if (quantity == "swap-free")
+				m_value_quantity = Quantity::SwapFree;
+			else
+			{
+				std::cerr << "unrecognized value for key '" << key << "'. valid keys are \"used\", \"free\", \"available\", \"cached\", \"swap-used\", \"swap-free\"" << std::endl;
+				std::cerr << "  " << value.source() << std::endl;
+				exit(1);
+			}
+			return true;
+		}
+
+		if (key == "size-precision")
+		{
+			BSBAR_VERIFY_TYPE(value, integer, key);
+			m_size_precision = **value.as_integer();
+			return true;
+		}
+
+		return false;
+	}
+
+	uint64_t MemoryBlock::get_quantity(Quantity quantity, const uint64_t (&values)[KeyCount]) const
+	{
+		switch (quantity)
+		{
+			case Quantity::Total:		return values[MemTotal];
+			case Quantity::Used:		return values[MemTotal] - std::min(values[MemAvailable], values[MemTotal]);
+			case Quantity::Free:		return values[MemFree];
+			case Quantity::Available:	return values[MemAvailable];
+			case Quantity::Cached:		return values[Cached] + values[SReclaimable];
+			case Quantity::SwapTotal:	return values[SwapTotal];
+			case Quantity::SwapUsed:	return values[SwapTotal] - std::min(values[SwapFree], values[SwapTotal]);
+			case Quantity::SwapFree:	return values[SwapFree];
+		}
+		return 0;
+	}
+
+	bool MemoryBlock::custom_update(time_point tp)
+	{
+		// Sampler shares the read with other memory blocks, but leaves meminfo unparsed
+		auto snapshot = Sampler::get(Sampler::Source::Meminfo, tp);
+		if (!snapshot)
+			return false;
+
+		uint64_t values[KeyCount] {};
+		if (!meminfo::scan(snapshot->data, m_key_mask, values))
+			return false;
+
+		std::scoped_lock _(m_mutex);
+
+		m_text = m_format;
+
+		for (const auto& [placeholder, quantity] : m_placeholders)
+			replace_all(m_text, placeholder, bytes_to_string(get_quantity(quantity, values) * 1024.0, m_size_precision));
+
+		if (m_value_quantity)
+		{
+			bool is_swap = (*m_value_quantity == Quantity::SwapUsed || *m_value_quantity == Quantity::SwapFree);
+			double total = get_quantity(is_swap ? Quantity::SwapTotal : Quantity::Total, values);
+			m_value.value = total > 0.0 ? get_quantity(*m_value_quantity, values) / total * 100.0 : 0.0;
+		}
+
+		return true;
+	}
+
+}
\ No newline at end of file
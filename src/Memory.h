@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Block.h"
+#include "Meminfo.h"
+
+namespace bsbar
+{
+
+	class MemoryBlock : public Block
+	{
+	public:
+		virtual bool custom_is_valid() const override;
+		virtual void custom_config_done() override;
+
+		virtual bool add_custom_config(std::string_view key, toml::node& value) override;
+		virtual bool custom_update(time_point) override;
+
+	private:
+		enum class Quantity
+		{
+			Total,
+			Used,
+			Free,
+			Available,
+			Cached,
+			SwapTotal,
+			SwapUsed,
+			SwapFree,
+		};
+
+	private:
+		static uint32_t keys_for_quantity(Quantity quantity);
+		uint64_t get_quantity(Quantity quantity, const uint64_t (&values)[meminfo::KeyCount]) const;
+
+	private:
+		uint32_t								m_key_mask			= 0;
+		int										m_size_precision	= 1;
+		std::optional<Quantity>					m_value_quantity;
+		std::vector<std::pair<std::string_view, Quantity>> m_placeholders;
+	};
+
+}
\ No newline at end of file
@@ -12,17 +12,53 @@ namespace bsbar
 	{
 		std::sort(m_submenus.begin(), m_submenus.end(), [](const auto& a, const auto& b) { return a->get_instance() < b->get_instance(); });
 		for (auto& submenu : m_submenus)
-			submenu->initialize();
+			submenu->initialize(!m_show_submenus);
 	}
 
-	void MenuBlock::custom_tick()
+	void MenuBlock::custom_stop()
+	{
+		for (auto& submenu : m_submenus)
+			submenu->stop();
+	}
+
+	// Timeout is checked when the main loop wakes up, so it is accurate to the menu's own interval
+	void MenuBlock::custom_tick(time_point tp)
 	{
 		if (!m_show_submenus)
+		{
+			m_shown_since.reset();
+			return;
+		}
+		if (!m_shown_since)
+			m_shown_since = tp;
+		if (!m_timeout || tp - *m_shown_since < *m_timeout)
+			return;
+		set_submenus_shown(false);
+		m_shown_since.reset();
+	}
+
+	void MenuBlock::set_submenus_shown(bool show)
+	{
+		std::scoped_lock _(m_submenus_mutex);
+
+		if (m_show_submenus == show)
 			return;
-		if (++m_timeout_ticks % m_timeout)
+
+		if (!show)
+		{
+			m_show_submenus = false;
+			for (auto& submenu : m_submenus)
+				submenu->sleep();
 			return;
-		m_show_submenus = false;
-		m_timeout_ticks = 0;
+		}
+
+		// Every submenu is refreshed before the expanded menu is shown
+		auto tp = Clock::now();
+		for (auto& submenu : m_submenus)
+			submenu->wake(tp);
+		for (auto& submenu : m_submenus)
+			submenu->block_until_updated(tp);
+		m_show_submenus = true;
 	}
 
 	bool MenuBlock::custom_is_valid() const
@@ -33,24 +69,22 @@ namespace bsbar
 		return true;
 	}
 
-	bool MenuBlock::custom_update(time_point tp)
+	bool MenuBlock::custom_update(time_point)
 	{
 		std::scoped_lock _(m_mutex);
 		m_text = m_format;
-		for (auto& submenu : m_submenus)
-			submenu->m_i3bar["separator"] = { .is_string = false, .value = "false" };
 		return true;
 	}
 
-	bool MenuBlock::custom_print() const
+	bool MenuBlock::custom_print(std::string& out) const
 	{
 		if (!m_show_submenus)
 			return true;
 
 		for (const auto& submenu : m_submenus)
 		{
-			submenu->print();
-			std::printf(",");
+			submenu->print(out);
+			out += ',';
 		}
 
 		return true;
@@ -58,15 +92,15 @@ namespace bsbar
 
 	bool MenuBlock::handle_custom_click(const MouseInfo& mouse, std::string_view sub)
 	{
-		std::scoped_lock _(m_mutex);
 		if (sub.empty())
 		{
 			if (mouse.type != MouseType::Left)
 				return true;
-			m_show_submenus = !m_show_submenus;
+			set_submenus_shown(!m_show_submenus);
 		}
 		else
 		{
+			std::scoped_lock _(m_mutex);
 			for (auto& submenu : m_submenus)
 			{
 				if (submenu->get_instance().substr(submenu->get_instance().find('.') + 1) == sub)
@@ -93,9 +127,9 @@ namespace bsbar
 			BSBAR_VERIFY_TYPE(value, integer, key);
 			int64_t timeout = **value.as_integer();
 			if (timeout == 0)
-				m_timeout = UINT64_MAX;
+				m_timeout.reset();
 			else if (timeout > 0)
-				m_timeout = timeout;
+				m_timeout = std::chrono::seconds(timeout);
 			else
 			{
 				std::cerr << "Value for key 'timeout' must be positive integer or 0 to disable timeout" << std::endl;
@@ -113,6 +147,9 @@ namespace bsbar
 		if (sub.size() < 4 || sub.substr(0, 3) != "sub" || sub.substr(3).find_first_not_of("0123456789") != std::string_view::npos)
 			return false;
 
+		// Submenus are shown next to each other, so they never have a separator
+		table.insert_or_assign("separator", false);
+
 		std::string sub_name = m_name + '.' + std::string(sub);
 		m_submenus.push_back(Block::create(sub_name, table));
 		assert(m_submenus.back().get());
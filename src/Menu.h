@@ -9,13 +9,14 @@ namespace bsbar
 	{
 	public:
 		virtual void custom_initialize() override;
+		virtual void custom_stop() override;
 
-		virtual void custom_tick() override;
+		virtual void custom_tick(time_point tp) override;
 
 		virtual bool custom_is_valid() const override;
 
 		virtual bool custom_update(time_point tp) override;
-		virtual bool custom_print() const override;
+		virtual bool custom_print(std::string& out) const override;
 		
 		virtual bool handle_custom_click(const MouseInfo& mouse, std::string_view sub) override;
 
@@ -23,11 +24,16 @@ namespace bsbar
 		virtual bool add_custom_subconfig(std::string_view sub, toml::table& table) override;
 
 	private:
-		std::atomic<uint64_t>				m_timeout		= UINT64_MAX;
-		std::atomic<uint64_t>				m_timeout_ticks	= 0;
+		// Submenus only have update threads while they are shown
+		void set_submenus_shown(bool show);
+
+	private:
+		std::optional<std::chrono::seconds>	m_timeout;
+		std::optional<time_point>			m_shown_since;
 
 		std::atomic<bool>					m_show_submenus	= false;
 		std::vector<std::unique_ptr<Block>>	m_submenus;
+		std::mutex							m_submenus_mutex;
 	};
 
 }
\ No newline at end of file
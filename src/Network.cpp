@@ -2,9 +2,7 @@
 
 #include "Common.h"
 
-#include <iomanip>
 #include <iostream>
-#include <sstream>
 
 #include <arpa/inet.h>
 #include <ifaddrs.h>
@@ -108,29 +106,20 @@ namespace bsbar
 		if (!ips)
 			return false;
 
-		std::string color;
+		// Red at -100 dBm, yellow at -50 dBm and green at 0 dBm, shared by every network block
+		static const ColorRamp s_rssi_ramp({ "#ff0000", "#ffff00", "#00ff00" }, -100.0, 0.0);
+
+		std::string_view color;
 		if (m_color_auto)
 		{
 			if (int rssi = get_rssi(m_interface); rssi != 1)
-			{
-				int r = std::clamp<int>(map<double>(rssi,    0, -50, 0x00, 0xff), 0x00, 0xff);
-				int g = std::clamp<int>(map<double>(rssi, -100, -50, 0x00, 0xff), 0x00, 0xff);
-				int b = 0;
-
-				std::stringstream ss;
-				ss << std::hex << std::setfill('0');
-				ss << '#';
-				ss << std::setw(2) << r;
-				ss << std::setw(2) << g;
-				ss << std::setw(2) << b;
-				color = ss.str();
-			}
+				color = s_rssi_ramp.get(rssi);
 		}
 
 		std::scoped_lock _(m_mutex);
 
 		if (!color.empty())
-			m_i3bar["color"] = { .is_string = true, .value = color };
+			m_i3bar["color"] = { .is_string = true, .value = std::string(color) };
 
 		if (auto it = ips->find(m_interface); it != ips->end() && !it->second.ipv4.empty())
 		{
@@ -0,0 +1,211 @@
+#include "Power.h"
+
+#include "Block.h"
+#include "Common.h"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+namespace bsbar
+{
+
+	static constexpr auto s_check_interval = std::chrono::seconds(5);
+
+	struct PowerState
+	{
+		std::mutex					mutex;
+		std::optional<PowerConfig>	config;
+		bool						apply		= false;
+		std::optional<bool>			on_battery;
+		Clock::time_point			next_check	= {};
+		Clock::time_point			since		= {};
+
+		// Indexed by on_battery
+		struct
+		{
+			uint64_t						wakeups	= 0;
+			Clock::time_point::duration		time	= {};
+		} totals[2];
+	};
+	static PowerState s_state;
+
+	static double node_to_double(toml::node& value)
+	{
+		return value.is_integer() ? **value.as_integer() : **value.as_floating_point();
+	}
+
+	static PowerProfile parse_profile(toml::table& table, std::string_view name, PowerProfile profile)
+	{
+		for (auto& [key, value] : table)
+		{
+			if (key == "interval-scale")
+			{
+				BSBAR_VERIFY_TYPE(value, number, key);
+				profile.interval_scale = node_to_double(value);
+				if (profile.interval_scale < 1.0)
+				{
+					std::cerr << "Value for key 'interval-scale' must be at least 1" << std::endl;
+					std::cerr << "  " << value.source() << std::endl;
+					exit(1);
+				}
+			}
+			else if (key == "align")
+			{
+				BSBAR_VERIFY_TYPE(value, number, key);
+				double align = node_to_double(value);
+				if (align < 0.0)
+				{
+					std::cerr << "Value for key 'align' must be a non-negative number of seconds" << std::endl;
+					std::cerr << "  " << value.source() << std::endl;
+					exit(1);
+				}
+				profile.align = std::chrono::milliseconds((int64_t)std::round(align * 1000.0));
+			}
+			else if (key == "suspend-custom")
+			{
+				BSBAR_VERIFY_TYPE(value, boolean, key);
+				profile.suspend_custom = **value.as_boolean();
+			}
+			else
+			{
+				std::cerr << "Unknown key '" << key << "' for 'power-profile." << name << '\'' << std::endl;
+				std::cerr << "  " << value.source() << std::endl;
+				exit(1);
+			}
+		}
+		return profile;
+	}
+
+	PowerConfig parse_power_config(toml::node& node)
+	{
+		BSBAR_VERIFY_TYPE_CUSTOM_MESSAGE(node, table, "value for global key 'power-profile' must be a table");
+
+		PowerConfig config;
+		for (auto& [key, value] : *node.as_table())
+		{
+			if (key == "adapter")
+			{
+				BSBAR_VERIFY_TYPE(value, string, key);
+				config.online_path = "/sys/class/power_supply/" + **value.as_string() + "/online";
+			}
+			else if (key == "ac" || key == "battery")
+			{
+				BSBAR_VERIFY_TYPE_CUSTOM_MESSAGE(value, table, "value for key 'power-profile." << key << "' must be a table");
+				auto& target = (key == "battery") ? config.battery : config.ac;
+				target = parse_profile(*value.as_table(), key, target);
+			}
+			else
+			{
+				std::cerr << "Unknown key '" << key << "' for 'power-profile'" << std::endl;
+				std::cerr << "  " << value.source() << std::endl;
+				exit(1);
+			}
+		}
+
+		config.online_path = system_path(config.online_path);
+		return config;
+	}
+
+	void set_power_config(std::optional<PowerConfig> config)
+	{
+		std::scoped_lock _(s_state.mutex);
+		s_state.config		= std::move(config);
+		s_state.apply		= true;
+		s_state.next_check	= {};
+	}
+
+	// Missing adapter (e.g. desktop) counts as AC, so nothing is throttled
+	static bool read_on_battery(const std::string& path)
+	{
+		std::ifstream file(path);
+		if (file.fail())
+			return false;
+
+		std::string line;
+		file >> line;
+
+		int64_t online;
+		if (!string_to_value(line, online))
+			return false;
+		return online == 0;
+	}
+
+	bool poll_power_state(Clock::time_point tp)
+	{
+		std::scoped_lock _(s_state.mutex);
+
+		if (!s_state.config)
+		{
+			if (!std::exchange(s_state.apply, false))
+				return false;
+			s_state.on_battery.reset();
+			Block::set_power_profile(PowerProfile {});
+			return true;
+		}
+
+		bool changed = false;
+		if (tp >= s_state.next_check)
+		{
+			s_state.next_check = tp + s_check_interval;
+
+			bool on_battery = read_on_battery(s_state.config->online_path);
+			if (s_state.on_battery != on_battery)
+			{
+				if (s_state.on_battery)
+				{
+					s_state.totals[*s_state.on_battery].time += tp - s_state.since;
+					std::cerr << "Switched to " << (on_battery ? "battery" : "AC") << " power profile" << std::endl;
+				}
+				s_state.on_battery	= on_battery;
+				s_state.since		= tp;
+				s_state.apply		= true;
+			}
+
+			if (std::exchange(s_state.apply, false))
+			{
+				const auto& config = *s_state.config;
+				Block::set_power_profile(on_battery ? config.battery : config.ac);
+				changed = true;
+			}
+		}
+
+		s_state.totals[s_state.on_battery.value_or(false)].wakeups++;
+		return changed;
+	}
+
+	void dump_power_stats(std::ostream& out)
+	{
+		std::scoped_lock _(s_state.mutex);
+
+		if (!s_state.config || !s_state.on_battery)
+			return;
+
+		bool on_battery = *s_state.on_battery;
+		const auto& profile = on_battery ? s_state.config->battery : s_state.config->ac;
+
+		out << "power: on " << (on_battery ? "battery" : "AC");
+		out << ", interval scale " << profile.interval_scale;
+		out << ", align " << profile.align.count() << " ms";
+		out << ", custom blocks " << (profile.suspend_custom ? "suspended" : "running") << std::endl;
+
+		auto precision = out.precision();
+		for (bool state : { false, true })
+		{
+			auto totals = s_state.totals[state];
+			if (state == on_battery)
+				totals.time += Clock::now() - s_state.since;
+
+			double seconds = std::chrono::duration<double>(totals.time).count();
+			if (seconds <= 0.0)
+				continue;
+
+			out << "  " << std::left << std::setw(12) << (state ? "battery" : "AC") << std::right;
+			out << totals.wakeups << " wakeups in " << std::fixed << std::setprecision(0) << seconds << " s";
+			out << std::setprecision(3) << " (" << totals.wakeups / seconds << " per second)" << std::defaultfloat << std::setprecision(precision) << std::endl;
+		}
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Clock.h"
+#include "toml_include.h"
+
+#include <chrono>
+#include <optional>
+#include <ostream>
+#include <string>
+
+namespace bsbar
+{
+
+	// Scheduling changes of one power state, see [power-profile]
+	struct PowerProfile
+	{
+		double						interval_scale	= 1.0;
+		std::chrono::milliseconds	align			= {};
+		bool						suspend_custom	= false;
+	};
+
+	struct PowerConfig
+	{
+		std::string		online_path		= "/sys/class/power_supply/AC/online";
+		PowerProfile	ac;
+		PowerProfile	battery			= { .interval_scale = 2.0 };
+	};
+
+	PowerConfig parse_power_config(toml::node& node);
+
+	// Replaces the profiles, nullopt goes back to unmodified scheduling.
+	// Profile is applied on the next poll_power_state().
+	void set_power_config(std::optional<PowerConfig> config);
+
+	// Called by the scheduler on every wakeup. Reads AC adapter state at most every 5 seconds
+	// and applies the matching profile to blocks. Returns true if the profile changed.
+	bool poll_power_state(Clock::time_point tp);
+
+	// Writes active profile and wakeups per second in each power state
+	void dump_power_stats(std::ostream& out);
+
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "Published.h"
+
+#include <algorithm>
+
+namespace bsbar
+{
+
+	// Slot holding nullptr is free. There are never more readers than threads printing frames.
+	static constexpr std::size_t					s_hazard_count = 32;
+	static std::atomic<const std::string*>			s_hazards[s_hazard_count];
+
+	static std::atomic<const std::string*>& claim_hazard(const std::string* value)
+	{
+		while (true)
+		{
+			for (auto& hazard : s_hazards)
+			{
+				const std::string* expected = nullptr;
+				if (hazard.load(std::memory_order_relaxed) == nullptr && hazard.compare_exchange_strong(expected, value))
+					return hazard;
+			}
+		}
+	}
+
+	static bool is_hazard(const std::string* value)
+	{
+		for (const auto& hazard : s_hazards)
+			if (hazard.load() == value)
+				return true;
+		return false;
+	}
+
+	PublishedString::~PublishedString()
+	{
+		delete m_current.load();
+		for (const auto* retired : m_retired)
+			delete retired;
+	}
+
+	bool PublishedString::publish(std::string value)
+	{
+		// Only the writer replaces m_current, so it can be read without hazard
+		if (const auto* current = m_current.load(); current && *current == value)
+			return false;
+
+		if (const auto* old = m_current.exchange(new std::string(std::move(value))))
+			m_retired.push_back(old);
+
+		auto it = std::partition(m_retired.begin(), m_retired.end(), is_hazard);
+		for (auto free = it; free != m_retired.end(); free++)
+			delete *free;
+		m_retired.erase(it, m_retired.end());
+
+		return true;
+	}
+
+	bool PublishedString::append_to(std::string& out) const
+	{
+		const std::string* value = m_current.load();
+		if (value == nullptr)
+			return false;
+
+		// Value may have been replaced and retired before the hazard became visible to the writer.
+		// Once the hazard holds the current value, the writer can't free it.
+		auto& hazard = claim_hazard(value);
+		for (const std::string* current; (current = m_current.load()) != value; )
+		{
+			value = current;
+			hazard.store(value);
+		}
+
+		out += *value;
+
+		hazard.store(nullptr);
+		return true;
+	}
+
+}
\ No newline at end of file
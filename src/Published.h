@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace bsbar
+{
+
+	// String with one writer and any number of readers. Readers never lock or wait: the value
+	// being read is protected by a hazard pointer, and the writer frees replaced values once no
+	// reader holds them.
+	class PublishedString
+	{
+	public:
+		PublishedString() = default;
+		~PublishedString();
+
+		PublishedString(const PublishedString&) = delete;
+		PublishedString& operator=(const PublishedString&) = delete;
+
+		// Callers must make sure only one thread publishes at a time.
+		// Returns false if `value` equals the current value, which is then kept.
+		bool publish(std::string value);
+
+		// Appends the latest value to `out`. Returns false if nothing has been published.
+		bool append_to(std::string& out) const;
+
+	private:
+		std::atomic<const std::string*>	m_current = nullptr;
+		std::vector<const std::string*>	m_retired;
+	};
+
+}
\ No newline at end of file
@@ -8,51 +8,176 @@
 
 namespace bsbar
 {
-	using namespace std::chrono_literals;
+	static constexpr auto s_min_reconnect_delay	= std::chrono::milliseconds(250);
+	static constexpr auto s_max_reconnect_delay	= std::chrono::seconds(30);
+	static constexpr auto s_initialize_timeout	= std::chrono::milliseconds(500);
 
-	// Does not need mutex since it's readonly after initialization?
+	// Mainloop and api are readonly after initialization. Context and reconnect
+	// state are only touched while holding the mainloop lock.
 	struct ServerInfo
 	{
-		bool				initialized		= false;
+		bool						initialized		= false;
 
-		pa_mainloop*		mainloop		= NULL;
-		pa_mainloop_api*	mainloop_api	= NULL;
-		pa_context*			context			= NULL;
+		// Published once connection attempt is set up, see pa_initialize()
+		std::atomic<pa_threaded_mainloop*>	mainloop	= NULL;
+		pa_mainloop_api*			mainloop_api	= NULL;
+		pa_context*					context			= NULL;
+
+		pa_time_event*				reconnect_event		= NULL;
+		bool						reconnect_pending	= false;
+		bool						failure_reported	= false;
+		std::chrono::milliseconds	reconnect_delay		= s_min_reconnect_delay;
 	};
 	static ServerInfo	s_server_info;
-	static std::thread	s_thread;
 
-	struct VolumeInfo
+	// Must be held when calling pa_* functions outside of mainloop thread.
+	// Lock order is mainloop lock -> DeviceTable::mutex.
+	struct MainloopLock
 	{
+		pa_threaded_mainloop* mainloop = s_server_info.mainloop;
+
+		MainloopLock()	{ if (mainloop) pa_threaded_mainloop_lock(mainloop); }
+		~MainloopLock()	{ if (mainloop) pa_threaded_mainloop_unlock(mainloop); }
+	};
+
+	struct Device
+	{
+		std::string				name;
+		uint32_t				index	= PA_INVALID_INDEX;
 		pa_cvolume				volume	= {};
 		bool					muted	= false;
-		uint32_t				index	= -1;
 
-		bool					updated	= false;
-		std::mutex				mutex;
-		std::condition_variable	cv;
+		// Blocks pinned to this device with 'device' key
+		std::vector<Block*>		blocks;
 
-		template<typename Rep, typename Period>
-		void wait_update_for(std::unique_lock<std::mutex>& lock, const std::chrono::duration<Rep, Period>& duration)
-		{
-			updated = false;
-			cv.wait_for(lock, duration, [this]() { return updated; });
-		}
+		// At most one info query is in flight per device, events arriving
+		// meanwhile are merged into a single follow-up query.
+		bool					query_in_flight	= false;
+		bool					query_pending	= false;
+
+		// Volume and mute are set optimistically when changed from bsbar. Info replies
+		// arriving before the operation completes are stale and thus ignored.
+		uint32_t				operations_in_flight	= 0;
+		bool					stale_info_ignored		= false;
+	};
+
+	// All sinks or sources of the server. Every device is known by name and index,
+	// but only devices shown by some block are refreshed on change events.
+	struct DeviceTable
+	{
+		const bool									is_sink;
+
+		std::string									default_name	{};
+		std::unordered_map<std::string, Device>		devices			{};
+		std::unordered_map<uint32_t, Device*>		by_index		{};
+
+		// Blocks following the server's default device
+		std::vector<Block*>							default_blocks	{};
+
+		bool										has_server_info	= false;
+		bool										has_device_list	= false;
+		bool										disconnected	= false;
 
-		void wait_until_initialized()
+		std::mutex									mutex			{};
+		std::condition_variable						cv				{};
+
+		// Returns early if connection fails, blocks are updated once the server comes up
+		void wait_until_initialized(std::chrono::milliseconds timeout)
 		{
 			std::unique_lock lock(mutex);
-			cv.wait(lock, [this]() { return index != -1; });
+			cv.wait_for(lock, timeout, [this]() { return (has_server_info && has_device_list) || disconnected; });
 		}
 
 		void update()
 		{
-			updated = true;
 			cv.notify_all();
 		}
+
+		void add_block(Block* block, const std::string& device_name)
+		{
+			std::scoped_lock _(mutex);
+			if (device_name.empty())
+				default_blocks.push_back(block);
+			else
+			{
+				auto& device = devices[device_name];
+				device.name = device_name;
+				device.blocks.push_back(block);
+			}
+		}
+
+		void remove_block(Block* block)
+		{
+			std::scoped_lock _(mutex);
+			std::erase(default_blocks, block);
+			for (auto& [name, device] : devices)
+				std::erase(device.blocks, block);
+		}
+
+		// Requires mutex to be held. Returns nullptr if device is not currently available.
+		Device* find(const std::string& device_name)
+		{
+			auto it = devices.find(device_name.empty() ? default_name : device_name);
+			if (it == devices.end() || it->second.index == PA_INVALID_INDEX)
+				return nullptr;
+			return &it->second;
+		}
+
+		// Requires mutex to be held
+		bool is_watched(const Device& device) const
+		{
+			return !device.blocks.empty() || (device.name == default_name && !default_blocks.empty());
+		}
+
+		// Requires mutex to be held
+		std::vector<Block*> blocks_for(const Device& device) const
+		{
+			std::vector<Block*> result = device.blocks;
+			if (device.name == default_name)
+				result.insert(result.end(), default_blocks.begin(), default_blocks.end());
+			return result;
+		}
+
+		// Forgets everything learned from the server. Devices pinned by blocks are kept
+		// but marked unavailable. Returns all blocks of this table.
+		std::vector<Block*> reset()
+		{
+			std::scoped_lock _(mutex);
+
+			std::vector<Block*> result = default_blocks;
+
+			std::erase_if(devices, [](const auto& pair) { return pair.second.blocks.empty(); });
+			for (auto& [name, device] : devices)
+			{
+				device.index				= PA_INVALID_INDEX;
+				device.query_in_flight		= false;
+				device.query_pending		= false;
+				device.operations_in_flight	= 0;
+				device.stale_info_ignored	= false;
+				result.insert(result.end(), device.blocks.begin(), device.blocks.end());
+			}
+
+			by_index.clear();
+			default_name.clear();
+			has_server_info	= false;
+			has_device_list	= false;
+			disconnected	= true;
+			update();
+
+			return result;
+		}
+	};
+	static DeviceTable s_sinks	 { .is_sink = true	};
+	static DeviceTable s_sources { .is_sink = false	};
+
+	struct EventStats
+	{
+		std::atomic<uint64_t>	events_received	= 0;
+		std::atomic<uint64_t>	events_ignored	= 0;
+		std::atomic<uint64_t>	queries_issued	= 0;
+		std::atomic<uint64_t>	reconnects		= 0;
 	};
-	static VolumeInfo s_sink_info;
-	static VolumeInfo s_source_info;
+	static EventStats s_event_stats;
 
 	template<typename T>
 	static T pa_cvolume_to_percentage(const pa_cvolume* volume)
@@ -69,162 +194,441 @@ namespace bsbar
 	}
 
 
-	static int pa_run()
+	static void sink_info_callback(pa_context* context, const pa_sink_info* info, int eol, void* userdata);
+	static void source_info_callback(pa_context* context, const pa_source_info* info, int eol, void* userdata);
+
+	// Requires table's mutex to be held
+	static void query_device(pa_context* context, DeviceTable& table, Device& device)
+	{
+		if (device.query_in_flight)
+		{
+			device.query_pending = true;
+			return;
+		}
+
+		pa_operation* op = NULL;
+		if (device.index != PA_INVALID_INDEX)
+		{
+			if (table.is_sink)
+				op = pa_context_get_sink_info_by_index(context, device.index, sink_info_callback, &device);
+			else
+				op = pa_context_get_source_info_by_index(context, device.index, source_info_callback, &device);
+		}
+		else
+		{
+			if (table.is_sink)
+				op = pa_context_get_sink_info_by_name(context, device.name.c_str(), sink_info_callback, &device);
+			else
+				op = pa_context_get_source_info_by_name(context, device.name.c_str(), source_info_callback, &device);
+		}
+
+		if (op)
+		{
+			device.query_in_flight = true;
+			s_event_stats.queries_issued++;
+			pa_operation_unref(op);
+		}
+	}
+
+	static void notify_blocks(const std::vector<Block*>& blocks)
 	{
-		int ret = 1;
-		if (pa_mainloop_run(s_server_info.mainloop, &ret) < 0)
-			return ret;
-		return ret;
+		for (Block* block : blocks)
+			block->request_async_update();
 	}
 
-	static void pa_quit(int ret)
+	// `queried` is the device this info was queried for, or nullptr for list and new device queries
+	template<typename Info>
+	static void device_info_callback(DeviceTable& table, pa_context* context, const Info* info, int eol, Device* queried)
 	{
-		if (s_server_info.mainloop_api)
-			s_server_info.mainloop_api->quit(s_server_info.mainloop_api, ret);
+		std::vector<Block*> blocks;
+
+		{
+			std::scoped_lock _(table.mutex);
+
+			if (eol)
+			{
+				if (!queried)
+					return;
+				queried->query_in_flight = false;
+				if (queried->query_pending)
+				{
+					queried->query_pending = false;
+					query_device(context, table, *queried);
+				}
+				return;
+			}
+
+			auto& device = table.devices[info->name];
+			if (device.index != info->index)
+			{
+				if (device.index != PA_INVALID_INDEX)
+					table.by_index.erase(device.index);
+				table.by_index[info->index] = &device;
+			}
+
+			device.name		= info->name;
+			device.index	= info->index;
+
+			if (device.operations_in_flight)
+				device.stale_info_ignored = true;
+			else
+			{
+				device.volume	= info->volume;
+				device.muted	= info->mute;
+			}
+
+			table.update();
+			blocks = table.blocks_for(device);
+		}
+
+		notify_blocks(blocks);
 	}
 
+	template<typename Info>
+	static void device_list_callback(DeviceTable& table, pa_context* context, const Info* info, int eol)
+	{
+		if (!eol)
+			return device_info_callback(table, context, info, eol, nullptr);
+
+		std::scoped_lock _(table.mutex);
+		table.has_device_list = true;
+		table.update();
+	}
 
-	static void sink_info_callback(pa_context* context, const pa_sink_info* info, int eol, void*)
+	static void sink_info_callback(pa_context* context, const pa_sink_info* info, int eol, void* userdata)
 	{
-		if (!info)
-			return;
+		device_info_callback(s_sinks, context, info, eol, (Device*)userdata);
+	}
 
-		std::scoped_lock _(s_sink_info.mutex);
+	static void source_info_callback(pa_context* context, const pa_source_info* info, int eol, void* userdata)
+	{
+		device_info_callback(s_sources, context, info, eol, (Device*)userdata);
+	}
 
-		s_sink_info.volume	= info->volume;
-		s_sink_info.muted	= info->mute;
-		s_sink_info.index	= info->index;
+	static void sink_list_callback(pa_context* context, const pa_sink_info* info, int eol, void*)
+	{
+		device_list_callback(s_sinks, context, info, eol);
+	}
 
-		s_sink_info.update();
+	static void source_list_callback(pa_context* context, const pa_source_info* info, int eol, void*)
+	{
+		device_list_callback(s_sources, context, info, eol);
 	}
 
-	static void source_info_callback(pa_context* context, const pa_source_info* info, int eol, void*)
+	static void set_default_device(pa_context* context, DeviceTable& table, const char* name)
 	{
-		if (!info)
-			return;
+		std::vector<Block*> blocks;
+
+		{
+			std::scoped_lock _(table.mutex);
+
+			table.has_server_info = true;
+			table.update();
 
-		std::scoped_lock _(s_source_info.mutex);
+			if (!name || table.default_name == name)
+				return;
+			table.default_name = name;
 
-		s_source_info.volume	= info->volume;
-		s_source_info.muted		= info->mute;
-		s_source_info.index		= info->index;
+			// Default device is always refreshed, it may not have been watched before
+			auto& device = table.devices[name];
+			device.name = name;
+			query_device(context, table, device);
+
+			blocks = table.default_blocks;
+		}
 
-		s_source_info.update();
+		notify_blocks(blocks);
 	}
 
 	static void server_info_callback(pa_context* context, const pa_server_info* info, void*)
 	{
-		pa_context_get_sink_info_by_name(context, info->default_sink_name, sink_info_callback, NULL);
-		pa_context_get_source_info_by_name(context, info->default_source_name, source_info_callback, NULL);
+		if (!info)
+			return;
+		set_default_device(context, s_sinks,	info->default_sink_name);
+		set_default_device(context, s_sources,	info->default_source_name);
+	}
+
+	static void handle_device_event(pa_context* context, DeviceTable& table, pa_subscription_event_type_t type, uint32_t index)
+	{
+		std::vector<Block*> blocks;
+
+		{
+			std::scoped_lock _(table.mutex);
+
+			auto it = table.by_index.find(index);
+			if (it == table.by_index.end())
+			{
+				// New device has to be queried once to learn its name
+				if ((type & PA_SUBSCRIPTION_EVENT_TYPE_MASK) != PA_SUBSCRIPTION_EVENT_NEW)
+				{
+					s_event_stats.events_ignored++;
+					return;
+				}
+
+				pa_operation* op = table.is_sink
+					? pa_context_get_sink_info_by_index(context, index, sink_info_callback, NULL)
+					: pa_context_get_source_info_by_index(context, index, source_info_callback, NULL);
+				if (op)
+				{
+					s_event_stats.queries_issued++;
+					pa_operation_unref(op);
+				}
+				return;
+			}
+
+			Device& device = *it->second;
+
+			if ((type & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE)
+			{
+				table.by_index.erase(it);
+				device.index = PA_INVALID_INDEX;
+				blocks = table.blocks_for(device);
+			}
+			else if (table.is_watched(device))
+				query_device(context, table, device);
+			else
+				s_event_stats.events_ignored++;
+		}
+
+		notify_blocks(blocks);
 	}
 
 	static void subscribe_callback(pa_context* context, pa_subscription_event_type_t type, uint32_t index, void*)
 	{
 		unsigned facility = type & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
 
-		pa_operation *op = NULL;
+		s_event_stats.events_received++;
 
 		switch (facility)
 		{
 			case PA_SUBSCRIPTION_EVENT_SINK:
-				op = pa_context_get_sink_info_by_index(context, index, sink_info_callback, NULL);
+				handle_device_event(context, s_sinks, type, index);
 				break;
 
 			case PA_SUBSCRIPTION_EVENT_SOURCE:
-				op = pa_context_get_source_info_by_index(context, index, source_info_callback, NULL);
+				handle_device_event(context, s_sources, type, index);
 				break;
 
 			case PA_SUBSCRIPTION_EVENT_SERVER:
-				op = pa_context_get_server_info(context, server_info_callback, NULL);
+				if (auto op = pa_context_get_server_info(context, server_info_callback, NULL))
+				{
+					s_event_stats.queries_issued++;
+					pa_operation_unref(op);
+				}
 				break;
 
 			default:
-				fprintf(stderr, "pa_event %u\n", facility);
+				s_event_stats.events_ignored++;
 				break;
 		}
+	}
 
-		if (op)
-			pa_operation_unref(op);
+	static void connect_context();
+
+	static void reconnect_callback(pa_mainloop_api*, pa_time_event*, const struct timeval*, void*)
+	{
+		s_server_info.reconnect_pending = false;
+		s_event_stats.reconnects++;
+		connect_context();
+	}
+
+	// Requires mainloop lock to be held. Delay doubles on every failed attempt.
+	static void schedule_reconnect()
+	{
+		if (s_server_info.reconnect_pending)
+			return;
+		s_server_info.reconnect_pending = true;
+
+		struct timeval tv;
+		pa_gettimeofday(&tv);
+		pa_timeval_add(&tv, std::chrono::duration_cast<std::chrono::microseconds>(s_server_info.reconnect_delay).count());
+
+		auto* api = s_server_info.mainloop_api;
+		if (s_server_info.reconnect_event)
+			api->time_restart(s_server_info.reconnect_event, &tv);
+		else
+			s_server_info.reconnect_event = api->time_new(api, &tv, reconnect_callback, NULL);
+
+		s_server_info.reconnect_delay = std::min<std::chrono::milliseconds>(s_server_info.reconnect_delay * 2, s_max_reconnect_delay);
+	}
+
+	static void handle_disconnect(pa_context* context)
+	{
+		if (!s_server_info.failure_reported)
+		{
+			s_server_info.failure_reported = true;
+			std::cerr << "pulseaudio: " << pa_strerror(pa_context_errno(context)) << ", reconnecting" << std::endl;
+		}
+
+		auto blocks = s_sinks.reset();
+		auto sources = s_sources.reset();
+		blocks.insert(blocks.end(), sources.begin(), sources.end());
+		notify_blocks(blocks);
+
+		schedule_reconnect();
 	}
 
 	static void context_state_callback(pa_context* context, void*)
 	{
+		// State changes of a context that is already replaced are not interesting
+		if (context != s_server_info.context)
+			return;
+
 		switch (pa_context_get_state(context))
 		{
+			case PA_CONTEXT_UNCONNECTED:
 			case PA_CONTEXT_CONNECTING:
 			case PA_CONTEXT_AUTHORIZING:
 			case PA_CONTEXT_SETTING_NAME:
 				break;
 
 			case PA_CONTEXT_READY:
-				pa_context_get_server_info(context, server_info_callback, NULL);
-
+			{
+				if (s_server_info.failure_reported)
+					std::cerr << "pulseaudio: connected" << std::endl;
+				s_server_info.failure_reported	= false;
+				s_server_info.reconnect_delay	= s_min_reconnect_delay;
+
+				for (DeviceTable* table : { &s_sinks, &s_sources })
+				{
+					std::scoped_lock _(table->mutex);
+					table->disconnected = false;
+				}
+
+				if (auto op = pa_context_get_server_info(context, server_info_callback, NULL))
+					pa_operation_unref(op);
+				if (auto op = pa_context_get_sink_info_list(context, sink_list_callback, NULL))
+					pa_operation_unref(op);
+				if (auto op = pa_context_get_source_info_list(context, source_list_callback, NULL))
+					pa_operation_unref(op);
+
+				auto mask = (pa_subscription_mask_t)(PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SOURCE | PA_SUBSCRIPTION_MASK_SERVER);
 				pa_context_set_subscribe_callback(context, subscribe_callback, NULL);
-				pa_context_subscribe(context, PA_SUBSCRIPTION_MASK_ALL, NULL, NULL);
+				if (auto op = pa_context_subscribe(context, mask, NULL, NULL))
+					pa_operation_unref(op);
 				break;
+			}
 
 			case PA_CONTEXT_TERMINATED:
-				pa_quit(0);
-				break;
-
 			case PA_CONTEXT_FAILED:
 			default:
-				pa_quit(1);
+				handle_disconnect(context);
 				break;
 		}
 	}
 
-	static bool pa_initialize()
+	// Requires mainloop lock to be held (or mainloop not yet started).
+	// Failed context can't be reused, so a new one is created for every attempt.
+	static void connect_context()
 	{
-		if (s_server_info.initialized)
-			return true;
-
-		s_server_info.mainloop = pa_mainloop_new();
-		if (!s_server_info.mainloop)
+		if (s_server_info.context)
 		{
-			std::cerr << "pa_mainloop_new()" << std::endl;
-			return false;
+			pa_context_set_state_callback(s_server_info.context, NULL, NULL);
+			pa_context_set_subscribe_callback(s_server_info.context, NULL, NULL);
+			pa_context_disconnect(s_server_info.context);
+			pa_context_unref(s_server_info.context);
 		}
 
-		s_server_info.mainloop_api = pa_mainloop_get_api(s_server_info.mainloop);
-
-		s_server_info.context = pa_context_new(s_server_info.mainloop_api, "PulseAudio Test");
+		s_server_info.context = pa_context_new(s_server_info.mainloop_api, "bsbar");
 		if (!s_server_info.context)
 		{
 			std::cerr << "pa_context_new()" << std::endl;
-			return false;
+			schedule_reconnect();
+			return;
 		}
-		
+
+		pa_context_set_state_callback(s_server_info.context, context_state_callback, NULL);
+
 		if (pa_context_connect(s_server_info.context, NULL, PA_CONTEXT_NOAUTOSPAWN, NULL) < 0)
+			handle_disconnect(s_server_info.context);
+	}
+
+	// Blocks are initialized in parallel, first caller sets up the connection
+	static bool pa_initialize()
+	{
+		static std::mutex initialize_mutex;
+		std::scoped_lock _(initialize_mutex);
+
+		if (s_server_info.initialized)
+			return true;
+
+		pa_threaded_mainloop* mainloop = pa_threaded_mainloop_new();
+		if (!mainloop)
 		{
-			std::cerr << "pa_context_connect()" << std::endl;
+			std::cerr << "pa_threaded_mainloop_new()" << std::endl;
 			return false;
 		}
 
-		pa_context_set_state_callback(s_server_info.context, context_state_callback, NULL);
+		s_server_info.mainloop_api = pa_threaded_mainloop_get_api(mainloop);
+
+		// Mainloop thread is not running yet, so context can be set up without lock
+		connect_context();
+
+		s_server_info.mainloop = mainloop;
+
+		// Mainloop is not freed on failure, since other blocks may already be locking it
+		if (pa_threaded_mainloop_start(mainloop) < 0)
+		{
+			std::cerr << "pa_threaded_mainloop_start()" << std::endl;
+			return false;
+		}
 
 		s_server_info.initialized = true;
-		s_thread = std::thread(&pa_run);
 
 		return true;
 	}
 
-	static void pa_cleanup()
+	template<DeviceTable& table>
+	static void operation_callback(pa_context* context, int success, void* userdata)
 	{
-		if (s_server_info.context)
+		std::scoped_lock _(table.mutex);
+
+		Device& device = *(Device*)userdata;
+		device.operations_in_flight--;
+
+		// On failure the optimistic state is rolled back by querying the real state
+		if (!success || (device.operations_in_flight == 0 && device.stale_info_ignored))
 		{
-			pa_context_unref(s_server_info.context);
-			s_server_info.context = NULL;
+			device.stale_info_ignored = false;
+			query_device(context, table, device);
+		}
+	}
+
+	// Requires mainloop lock and table's mutex to be held
+	static void set_device_mute(DeviceTable& table, Device& device, bool muted)
+	{
+		device.muted = muted;
+
+		pa_operation* op = table.is_sink
+			? pa_context_set_sink_mute_by_index(s_server_info.context, device.index, muted, operation_callback<s_sinks>, &device)
+			: pa_context_set_source_mute_by_index(s_server_info.context, device.index, muted, operation_callback<s_sources>, &device);
+		if (op)
+		{
+			device.operations_in_flight++;
+			pa_operation_unref(op);
 		}
+	}
 
-		if (s_server_info.mainloop)
+	// Requires mainloop lock and table's mutex to be held
+	static void set_sink_volume(Device& device, const pa_cvolume& volume)
+	{
+		device.volume = volume;
+
+		if (auto op = pa_context_set_sink_volume_by_index(s_server_info.context, device.index, &volume, operation_callback<s_sinks>, &device))
 		{
-			pa_mainloop_free(s_server_info.mainloop);
-			s_server_info.mainloop = NULL;
-			s_server_info.mainloop_api = NULL;
+			device.operations_in_flight++;
+			pa_operation_unref(op);
 		}
 	}
 
+	void PulseAudioBlock::dump_stats(std::ostream& out)
+	{
+		out << "pulseaudio: events received " << s_event_stats.events_received;
+		out << ", ignored " << s_event_stats.events_ignored;
+		out << ", queries issued " << s_event_stats.queries_issued;
+		out << ", reconnects " << s_event_stats.reconnects << std::endl;
+	}
+
 	PulseAudioBlock::PulseAudioBlock()
 	{
 		m_max_volume	= percentage_to_pa_volume_t<uint32_t>(100);
@@ -233,14 +637,33 @@ namespace bsbar
 
 	void PulseAudioBlock::custom_initialize()
 	{
-		if (!pa_initialize())
-			exit(1);
-		s_sink_info.wait_until_initialized();
+		s_sinks.add_block(this, m_device);
+		if (pa_initialize())
+			s_sinks.wait_until_initialized(s_initialize_timeout);
+	}
+
+	void PulseAudioBlock::custom_stop()
+	{
+		// Mainloop lock guarantees that no callback is notifying this block meanwhile
+		MainloopLock _;
+		s_sinks.remove_block(this);
 	}
 
 	bool PulseAudioBlock::add_custom_config(std::string_view key, toml::node& value)
 	{
-		if (key == "format-muted")
+		if (key == "device")
+		{
+			BSBAR_VERIFY_TYPE(value, string, key);
+			m_device = **value.as_string();
+			return true;
+		}
+		else if (key == "format-disconnected")
+		{
+			BSBAR_VERIFY_TYPE(value, string, key);
+			m_format_disconnected = **value.as_string();
+			return true;
+		}
+		else if (key == "format-muted")
 		{
 			BSBAR_VERIFY_TYPE(value, string, key);
 			m_format_muted = **value.as_string();
@@ -294,27 +717,44 @@ namespace bsbar
 
 	bool PulseAudioBlock::custom_update(time_point tp)
 	{
-		std::scoped_lock _(s_sink_info.mutex, m_mutex);
+		if (m_verify_volume)
+		{
+			MainloopLock _;
+			std::scoped_lock __(s_sinks.mutex);
+
+			Device* device = s_sinks.find(m_device);
+			if (device && pa_cvolume_max(&device->volume) > m_max_volume)
+			{
+				pa_cvolume temp = device->volume;
+				if (pa_cvolume_set(&temp, temp.channels, m_max_volume))
+					set_sink_volume(*device, temp);
+			}
+		}
+
+		std::scoped_lock _(s_sinks.mutex, m_mutex);
+
+		Device* device = s_sinks.find(m_device);
+		if (!device)
+		{
+			if (!m_format_disconnected)
+				return false;
+			m_text = *m_format_disconnected;
+			m_i3bar.erase("color");
+			m_value.value = 0.0;
+			return true;
+		}
 
-		if (m_format_muted && s_sink_info.muted)
+		if (m_format_muted && device->muted)
 			m_text = *m_format_muted;
 		else
 			m_text = m_format;
 
-		if (m_color_muted && s_sink_info.muted)
+		if (m_color_muted && device->muted)
 			m_i3bar["color"] = { .is_string = true, .value = *m_color_muted };
 		else
 			m_i3bar.erase("color");
 
-		if (m_verify_volume && pa_cvolume_max(&s_sink_info.volume) > m_max_volume)
-		{
-			if (!pa_cvolume_set(&s_sink_info.volume, s_sink_info.volume.channels, m_max_volume))
-				return false;
-			auto op = pa_context_set_sink_volume_by_index(s_server_info.context, s_sink_info.index, &s_sink_info.volume, NULL, NULL);
-			pa_operation_unref(op);
-		}
-
-		m_value.value = pa_cvolume_to_percentage<double>(&s_sink_info.volume);
+		m_value.value = pa_cvolume_to_percentage<double>(&device->volume);
 
 		return true;
 	}
@@ -328,11 +768,24 @@ namespace bsbar
 		if (!sub.empty())
 			return true;
 
-		std::unique_lock lock(s_sink_info.mutex);
+		std::vector<Block*> blocks;
+
+		{
+			MainloopLock _;
+			std::scoped_lock __(s_sinks.mutex);
+
+			Device* device = s_sinks.find(m_device);
+			if (!device)
+				return true;
 
-		auto op = pa_context_set_sink_mute_by_index(s_server_info.context, s_sink_info.index, !s_sink_info.muted, NULL, NULL);
-		s_sink_info.wait_update_for(lock, 100ms);
-		pa_operation_unref(op);
+			set_device_mute(s_sinks, *device, !device->muted);
+			blocks = s_sinks.blocks_for(*device);
+
+			// This block is updated by the click handler, other blocks showing the same device are notified.
+			// Done under mainloop lock so none of them can be stopped meanwhile.
+			std::erase(blocks, this);
+			notify_blocks(blocks);
+		}
 
 		return true;
 	}
@@ -344,31 +797,39 @@ namespace bsbar
 		if (!sub.empty())
 			return true;
 
-		pa_cvolume temp;
-		{
-			std::scoped_lock _(s_sink_info.mutex);
-			temp = s_sink_info.volume;
-		}
-
-		switch (mouse.type)
-		{
-			case MouseType::ScrollUp:
-				if (!pa_cvolume_inc_clamp(&temp, m_volume_step, m_max_volume))
-					return false;
-				break;
-			case MouseType::ScrollDown:
-				if (!pa_cvolume_dec(&temp, m_volume_step))
-					return false;
-				break;
-		}
+		std::vector<Block*> blocks;
 
-		std::unique_lock lock(s_sink_info.mutex);
-
-		if (!pa_cvolume_equal(&temp, &s_sink_info.volume))
 		{
-			auto op = pa_context_set_sink_volume_by_index(s_server_info.context, s_sink_info.index, &temp, NULL, NULL);
-			s_sink_info.wait_update_for(lock, 100ms);
-			pa_operation_unref(op);
+			MainloopLock _;
+			std::scoped_lock __(s_sinks.mutex);
+
+			Device* device = s_sinks.find(m_device);
+			if (!device)
+				return true;
+
+			pa_cvolume temp = device->volume;
+			switch (mouse.type)
+			{
+				case MouseType::ScrollUp:
+					if (!pa_cvolume_inc_clamp(&temp, m_volume_step * mouse.count, m_max_volume))
+						return false;
+					break;
+				case MouseType::ScrollDown:
+					if (!pa_cvolume_dec(&temp, m_volume_step * mouse.count))
+						return false;
+					break;
+				default:
+					return true;
+			}
+
+			if (pa_cvolume_equal(&temp, &device->volume))
+				return true;
+
+			set_sink_volume(*device, temp);
+			blocks = s_sinks.blocks_for(*device);
+
+			std::erase(blocks, this);
+			notify_blocks(blocks);
 		}
 
 		return true;
@@ -377,14 +838,33 @@ namespace bsbar
 
 	void PulseAudioInputBlock::custom_initialize()
 	{
-		if (!pa_initialize())
-			exit(1);
-		s_source_info.wait_until_initialized();
+		s_sources.add_block(this, m_device);
+		if (pa_initialize())
+			s_sources.wait_until_initialized(s_initialize_timeout);
+	}
+
+	void PulseAudioInputBlock::custom_stop()
+	{
+		// Mainloop lock guarantees that no callback is notifying this block meanwhile
+		MainloopLock _;
+		s_sources.remove_block(this);
 	}
 
 	bool PulseAudioInputBlock::add_custom_config(std::string_view key, toml::node& value)
 	{
-		if (key == "format-muted")
+		if (key == "device")
+		{
+			BSBAR_VERIFY_TYPE(value, string, key);
+			m_device = **value.as_string();
+			return true;
+		}
+		else if (key == "format-disconnected")
+		{
+			BSBAR_VERIFY_TYPE(value, string, key);
+			m_format_disconnected = **value.as_string();
+			return true;
+		}
+		else if (key == "format-muted")
 		{
 			BSBAR_VERIFY_TYPE(value, string, key);
 			m_format_muted = **value.as_string();
@@ -408,19 +888,30 @@ namespace bsbar
 
 	bool PulseAudioInputBlock::custom_update(time_point tp)
 	{
-		std::scoped_lock _(s_source_info.mutex, m_mutex);
+		std::scoped_lock _(s_sources.mutex, m_mutex);
+
+		Device* device = s_sources.find(m_device);
+		if (!device)
+		{
+			if (!m_format_disconnected)
+				return false;
+			m_text = *m_format_disconnected;
+			m_i3bar.erase("color");
+			m_value.value = 0.0;
+			return true;
+		}
 
-		if (m_format_muted && s_source_info.muted)
+		if (m_format_muted && device->muted)
 			m_text = *m_format_muted;
 		else
 			m_text = m_format;
 
-		if (m_color_muted && s_source_info.muted)
+		if (m_color_muted && device->muted)
 			m_i3bar["color"] = { .is_string = true, .value = *m_color_muted };
 		else
 			m_i3bar.erase("color");
 
-		m_value.value = pa_cvolume_to_percentage<double>(&s_source_info.volume);
+		m_value.value = pa_cvolume_to_percentage<double>(&device->volume);
 
 		return true;
 	}
@@ -434,13 +925,24 @@ namespace bsbar
 		if (!sub.empty())
 			return true;
 
-		std::unique_lock lock(s_source_info.mutex);
+		std::vector<Block*> blocks;
+
+		{
+			MainloopLock _;
+			std::scoped_lock __(s_sources.mutex);
 
-		auto op = pa_context_set_source_mute_by_index(s_server_info.context, s_source_info.index, !s_source_info.muted, NULL, NULL);
-		s_source_info.wait_update_for(lock, 100ms);
-		pa_operation_unref(op);
+			Device* device = s_sources.find(m_device);
+			if (!device)
+				return true;
+
+			set_device_mute(s_sources, *device, !device->muted);
+			blocks = s_sources.blocks_for(*device);
+
+			std::erase(blocks, this);
+			notify_blocks(blocks);
+		}
 
 		return true;
 	}
 	
-}
+}
\ No newline at end of file
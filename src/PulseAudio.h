@@ -10,7 +10,10 @@ namespace bsbar
 	public:
 		PulseAudioBlock();
 
+		static void dump_stats(std::ostream& out);
+
 		virtual void custom_initialize() override;
+		virtual void custom_stop() override;
 
 		virtual bool custom_update(time_point tp) override;
 		virtual bool add_custom_config(std::string_view key, toml::node& value) override;
@@ -19,6 +22,8 @@ namespace bsbar
 		virtual bool handle_custom_scroll(const MouseInfo& mouse, std::string_view sub) override;
 
 	private:
+		std::string					m_device;
+		std::optional<std::string>	m_format_disconnected;
 		std::optional<std::string>	m_format_muted;
 		std::optional<std::string>	m_color_muted;
 		uint32_t					m_max_volume;
@@ -32,6 +37,7 @@ namespace bsbar
 	{
 	public:
 		virtual void custom_initialize() override;
+		virtual void custom_stop() override;
 
 		virtual bool custom_update(time_point tp) override;
 		virtual bool add_custom_config(std::string_view key, toml::node& value) override;
@@ -39,6 +45,8 @@ namespace bsbar
 		virtual bool handle_custom_click(const MouseInfo& mouse, std::string_view sub) override;
 
 	private:
+		std::string					m_device;
+		std::optional<std::string>	m_format_disconnected;
 		std::optional<std::string>	m_format_muted;
 		std::optional<std::string>	m_color_muted;
 		bool						m_click_to_mute = true;
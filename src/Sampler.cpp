@@ -0,0 +1,125 @@
+#include "Sampler.h"
+
+#include "Common.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+namespace bsbar
+{
+
+	struct SourceInfo
+	{
+		const char*							path;
+		// Consumers of unparsed sources scan Snapshot::data themselves
+		bool								parse_lines	= true;
+		int									fd			= -1;
+		bool								failed		= false;
+		std::shared_ptr<const Sampler::Snapshot>	snapshot	= nullptr;
+		std::mutex							mutex		{};
+	};
+
+	static SourceInfo s_sources[] = {
+		{ .path = "/proc/stat"				},
+		{ .path = "/proc/meminfo",			.parse_lines = false	},
+		{ .path = "/proc/loadavg"			},
+		{ .path = "/proc/pressure/cpu"		},
+		{ .path = "/proc/pressure/memory"	},
+		{ .path = "/proc/pressure/io"		},
+	};
+	static_assert(std::size(s_sources) == (std::size_t)Sampler::Source::Count);
+
+	const Sampler::Line* Sampler::Snapshot::find(std::string_view key) const
+	{
+		for (const auto& line : lines)
+			if (line.key == key)
+				return &line;
+		return nullptr;
+	}
+
+	static bool read_source(SourceInfo& source, std::string& out)
+	{
+		if (source.fd == -1)
+		{
+			if (source.failed)
+				return false;
+			source.fd = open(system_path(source.path).c_str(), O_RDONLY | O_CLOEXEC);
+			if (source.fd == -1)
+			{
+				source.failed = true;
+				return false;
+			}
+		}
+
+		char buffer[4096];
+		ssize_t nread;
+		off_t offset = 0;
+		while ((nread = pread(source.fd, buffer, sizeof(buffer), offset)) > 0)
+		{
+			out.append(buffer, nread);
+			offset += nread;
+		}
+
+		return nread == 0 && !out.empty();
+	}
+
+	// Splits every line into a key and up to Line::max_values numbers.
+	// Tokens of form 'name=number' (pressure files) are parsed as number.
+	void Sampler::parse(Snapshot& snapshot)
+	{
+		std::string_view data = snapshot.data;
+
+		for (auto line_sv : split(data, '\n'))
+		{
+			Line line;
+
+			bool first = true;
+			for (auto token : split(line_sv, ' '))
+			{
+				if (first)
+				{
+					first = false;
+					if (token.front() < '0' || token.front() > '9')
+					{
+						if (token.back() == ':')
+							token.remove_suffix(1);
+						line.key = token;
+						continue;
+					}
+				}
+
+				if (auto pos = token.find('='); pos != std::string_view::npos)
+					token = token.substr(pos + 1);
+
+				if (line.count < Line::max_values && string_to_value(token, line.values[line.count]))
+					line.count++;
+			}
+
+			snapshot.lines.push_back(line);
+		}
+	}
+
+	std::shared_ptr<const Sampler::Snapshot> Sampler::get(Source source_id, Block::time_point tp)
+	{
+		auto& source = s_sources[(std::size_t)source_id];
+
+		std::scoped_lock _(source.mutex);
+
+		if (source.snapshot && source.snapshot->time >= tp)
+			return source.snapshot;
+
+		auto snapshot = std::make_shared<Snapshot>();
+		if (!read_source(source, snapshot->data))
+			return nullptr;
+		if (source.parse_lines)
+			parse(*snapshot);
+
+		snapshot->version	= source.snapshot ? source.snapshot->version + 1 : 1;
+		snapshot->time		= tp;
+
+		source.snapshot = std::move(snapshot);
+		return source.snapshot;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Block.h"
+
+#include <array>
+#include <memory>
+
+namespace bsbar
+{
+
+	// Owns kernel statistics files shared by multiple blocks. Each source is read at most
+	// once per scheduler tick and consumers get an immutable snapshot of the parsed data.
+	class Sampler
+	{
+	public:
+		enum class Source
+		{
+			Stat,
+			Meminfo,
+			Loadavg,
+			PressureCpu,
+			PressureMemory,
+			PressureIo,
+			Count
+		};
+
+		struct Line
+		{
+			static constexpr std::size_t max_values = 12;
+
+			// First word of the line with trailing ':' removed. Empty if line starts with a number.
+			std::string_view					key;
+			std::array<double, max_values>		values {};
+			std::size_t							count = 0;
+		};
+
+		struct Snapshot
+		{
+			uint64_t				version	= 0;
+			Block::time_point		time;
+			std::string				data;
+			// Empty for Meminfo, whose only consumer scans just the keys it needs (see meminfo::scan)
+			std::vector<Line>		lines;
+
+			const Line* find(std::string_view key) const;
+		};
+
+	public:
+		// Returns snapshot that is not older than `tp`, or nullptr if source could not be read
+		static std::shared_ptr<const Snapshot> get(Source source, Block::time_point tp);
+
+		// Fills snapshot's lines from its data
+		static void parse(Snapshot& snapshot);
+	};
+
+}
\ No newline at end of file
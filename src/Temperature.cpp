@@ -21,6 +21,11 @@ namespace bsbar
 		return false;
 	}
 
+	void TemperatureBlock::custom_config_done()
+	{
+		m_temperature_path = system_path(m_temperature_path);
+	}
+
 	bool TemperatureBlock::custom_update(time_point)
 	{
 		std::ifstream file(m_temperature_path);
@@ -0,0 +1,36 @@
+#include "Allocations.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions, so it is linked only into Profile builds
+static std::atomic<uint64_t> s_allocation_count = 0;
+
+void* operator new(std::size_t size)
+{
+	s_allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+
+namespace bsbar::bench
+{
+
+	uint64_t allocation_count()
+	{
+		return s_allocation_count.load(std::memory_order_relaxed);
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+namespace bsbar::bench
+{
+
+	// Number of calls to the global operator new since start. Only builds that link
+	// Allocations.cpp have it, see the Profile configuration in premake5.lua.
+	uint64_t allocation_count();
+
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "Bench.h"
+
+#include <nlohmann/json.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+namespace bsbar::bench
+{
+
+	Harness::Harness(int argc, char** argv)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string_view arg = argv[i];
+			if (i + 1 < argc && arg == "--filter")
+				m_filter = argv[++i];
+			else if (i + 1 < argc && arg == "--output")
+				m_output_path = argv[++i];
+			else if (i + 1 < argc && arg == "--min-time")
+				m_min_time = std::chrono::milliseconds(std::atoi(argv[++i]));
+			else
+			{
+				std::cerr << "usage: " << argv[0] << " [--filter substring] [--min-time ms] [--output path]" << std::endl;
+				exit(1);
+			}
+		}
+
+		m_json_fd = dup(STDOUT_FILENO);
+		if (!std::freopen("/dev/null", "w", stdout))
+		{
+			std::cerr << "freopen(\"/dev/null\")\n  " << strerror(errno) << std::endl;
+			exit(1);
+		}
+	}
+
+	bool Harness::is_enabled(std::string_view name) const
+	{
+		return name.find(m_filter) != std::string_view::npos;
+	}
+
+	void Harness::report(std::string_view name, std::chrono::nanoseconds duration)
+	{
+		if (!is_enabled(name))
+			return;
+		add_result(name, 1, duration.count());
+	}
+
+	void Harness::add_result(std::string_view name, uint64_t iterations, double ns_per_op)
+	{
+		std::fprintf(stderr, "%-40.*s %14.1f ns/op %12lu iterations\n", (int)name.size(), name.data(), ns_per_op, (unsigned long)iterations);
+		m_results.push_back({ std::string(name), iterations, ns_per_op });
+	}
+
+	int Harness::finish()
+	{
+		nlohmann::json json;
+		json["version"] = 1;
+		json["results"] = nlohmann::json::array();
+		for (const auto& result : m_results)
+		{
+			json["results"].push_back({
+				{ "name",		result.name			},
+				{ "iterations",	result.iterations	},
+				{ "ns_per_op",	result.ns_per_op	},
+			});
+		}
+
+		std::string output = json.dump(1, '\t') + '\n';
+
+		if (!m_output_path.empty())
+		{
+			std::ofstream file(m_output_path);
+			if (!(file << output))
+			{
+				std::cerr << "Could not write '" << m_output_path << '\'' << std::endl;
+				return 1;
+			}
+			return 0;
+		}
+
+		for (std::size_t offset = 0; offset < output.size(); )
+		{
+			ssize_t nwrite = write(m_json_fd, output.data() + offset, output.size() - offset);
+			if (nwrite <= 0)
+				return 1;
+			offset += nwrite;
+		}
+		return 0;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bsbar::bench
+{
+
+	// Keeps the compiler from optimizing away computation of `value`
+	template<typename T>
+	inline void do_not_optimize(const T& value)
+	{
+		asm volatile("" : : "r,m"(value) : "memory");
+	}
+
+	// Minimal benchmark harness. Each benchmark is run until `min-time` has elapsed
+	// and mean time per operation is reported. Results are written as JSON to stdout
+	// or to the file given with --output. Benchmarks print to stdout, so stdout is
+	// redirected to /dev/null while they run.
+	//
+	// usage: bsbar_bench [--filter substring] [--min-time ms] [--output path]
+	class Harness
+	{
+	public:
+		struct Result
+		{
+			std::string		name;
+			uint64_t		iterations;
+			double			ns_per_op;
+		};
+
+	public:
+		Harness(int argc, char** argv);
+
+		bool is_enabled(std::string_view name) const;
+
+		// Calls `fn` repeatedly. `fn` is one operation.
+		template<typename F>
+		void run(std::string_view name, F&& fn)
+		{
+			if (!is_enabled(name))
+				return;
+
+			fn();
+
+			uint64_t iterations = 0;
+			uint64_t batch = 1;
+			auto start = clock::now();
+			while (clock::now() - start < m_min_time)
+			{
+				for (uint64_t i = 0; i < batch; i++)
+					fn();
+				iterations += batch;
+				batch *= 2;
+			}
+			auto elapsed = clock::now() - start;
+
+			add_result(name, iterations, std::chrono::duration<double, std::nano>(elapsed).count() / iterations);
+		}
+
+		// Reports a single measured duration, e.g. time until something happens
+		void report(std::string_view name, std::chrono::nanoseconds duration);
+
+		// Writes results, returns exit code for main
+		int finish();
+
+	private:
+		using clock = std::chrono::steady_clock;
+
+		void add_result(std::string_view name, uint64_t iterations, double ns_per_op);
+
+	private:
+		std::string					m_filter;
+		std::string					m_output_path;
+		std::chrono::milliseconds	m_min_time	= std::chrono::milliseconds(200);
+		int							m_json_fd	= -1;
+		std::vector<Result>			m_results;
+	};
+
+}
\ No newline at end of file
@@ -0,0 +1,318 @@
+#include "Bench.h"
+
+#include "Battery.h"
+#include "ColorRamp.h"
+#include "Common.h"
+#include "Config.h"
+#include "Histogram.h"
+#include "History.h"
+#include "I3bar.h"
+#include "Meminfo.h"
+#include "Sampler.h"
+#include "Temperature.h"
+
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace bsbar;
+using bench::do_not_optimize;
+
+static constexpr std::string_view s_stat_fixture =
+	"cpu  2255 34 2290 22625563 6290 127 456 0 0 0\n"
+	"cpu0 1132 34 1441 11311718 3675 127 438 0 0 0\n"
+	"cpu1 1123 0 849 11313845 2614 0 18 0 0 0\n"
+	"intr 114930548 113199788 3 0 5 263 0 4 [... 200 values ...]\n"
+	"ctxt 1990473\n"
+	"btime 1062191376\n"
+	"processes 2915\n"
+	"procs_running 1\n"
+	"procs_blocked 0\n"
+	"softirq 183433 0 21755 12 39 1137 231 21459 2263\n";
+
+static constexpr std::string_view s_meminfo_fixture =
+	"MemTotal:       32599760 kB\n"
+	"MemFree:        18062144 kB\n"
+	"MemAvailable:   26283180 kB\n"
+	"Buffers:          485532 kB\n"
+	"Cached:          7862920 kB\n"
+	"SwapCached:            0 kB\n"
+	"Active:          5731064 kB\n"
+	"Inactive:        6933420 kB\n"
+	"SReclaimable:     436776 kB\n"
+	"SUnreclaim:       180536 kB\n"
+	"SwapTotal:       8388604 kB\n"
+	"SwapFree:        8388604 kB\n";
+
+static constexpr std::string_view s_pressure_fixture =
+	"some avg10=0.12 avg60=0.08 avg300=0.02 total=1234567\n"
+	"full avg10=0.00 avg60=0.00 avg300=0.00 total=12345\n";
+
+static constexpr std::string_view s_click_fixture =
+	",{\"name\":\"internal/pulseaudio.output\",\"instance\":\"volume\",\"button\":1,\"modifiers\":[],"
+	"\"x\":1650,\"y\":10,\"relative_x\":12,\"relative_y\":10,\"output_x\":1650,\"output_y\":10,\"width\":60,\"height\":22}";
+
+// Config with `count` datetime blocks. 'format-loading' gives every block text without starting it.
+static std::string make_config(std::size_t count)
+{
+	std::stringstream ss;
+	ss << "order = [";
+	for (std::size_t i = 0; i < count; i++)
+		ss << (i ? ", " : "") << "\"b" << i << '"';
+	ss << "]\n";
+	for (std::size_t i = 0; i < count; i++)
+	{
+		ss << "[b" << i << "]\n";
+		ss << "type = \"internal/datetime\"\n";
+		ss << "format = \"%a %d.%m. %T\"\n";
+		ss << "format-loading = \"Mon 01.01. 12:34:56\"\n";
+		ss << "color = \"#88c0d0\"\n";
+		ss << "separator = false\n";
+	}
+	return ss.str();
+}
+
+static void bench_common(bench::Harness& harness)
+{
+	harness.run("common/replace_all", []() {
+		std::string text = "CPU %value%% %ramp% (%value%)";
+		replace_all(text, "%value%", "42");
+		do_not_optimize(text);
+	});
+
+	harness.run("common/value_to_string", []() {
+		do_not_optimize(value_to_string(42.4242, 2));
+	});
+
+	harness.run("common/bytes_to_string", []() {
+		do_not_optimize(bytes_to_string(3.5 * 1024 * 1024 * 1024, 1));
+	});
+
+	std::vector<std::string> ramp = { "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█" };
+	harness.run("common/get_ramp_string", [&]() {
+		do_not_optimize(get_ramp_string(63.0, 0.0, 100.0, ramp));
+	});
+
+	ColorRamp color_ramp({ "#00ff00", "#ffff00", "#ff0000" }, 0.0, 100.0);
+	harness.run("common/color_ramp", [&]() {
+		do_not_optimize(color_ramp.get(63.0));
+	});
+
+	History history(History::max_capacity, 0.0, 100.0, true);
+	double sample = 0.0;
+	harness.run("common/history_push", [&]() {
+		sample = sample >= 100.0 ? 0.0 : sample + 7.0;
+		history.push(sample);
+		do_not_optimize(history.sparkline());
+	});
+
+	harness.run("common/split", []() {
+		do_not_optimize(split(s_stat_fixture.substr(0, s_stat_fixture.find('\n')), ' '));
+	});
+}
+
+static void bench_print(bench::Harness& harness)
+{
+	auto single = parse_config_string(make_config(1), "bench");
+	std::string out;
+	harness.run("print/block", [&]() {
+		out.clear();
+		single.blocks.front()->print(out);
+		do_not_optimize(out);
+	});
+
+	for (std::size_t count : { 10, 100, 1000 })
+	{
+		auto config = parse_config_string(make_config(count), "bench");
+		harness.run("print/frame/" + std::to_string(count), [&]() {
+			out.clear();
+			render_frame(config.blocks, out);
+			do_not_optimize(out);
+		});
+	}
+}
+
+// Updater threads publish new texts while frames are rendered. Build with config=tsan
+// and run with '--filter concurrent' to check printing for data races.
+static void bench_concurrent(bench::Harness& harness)
+{
+	constexpr std::size_t block_count	= 100;
+	constexpr std::size_t updater_count	= 4;
+
+	std::stringstream ss;
+	ss << "order = [";
+	for (std::size_t i = 0; i < block_count; i++)
+		ss << (i ? ", " : "") << "\"b" << i << '"';
+	ss << "]\n";
+	for (std::size_t i = 0; i < block_count; i++)
+		ss << "[b" << i << "]\ntype = \"custom\"\nformat = \"%text%\"\ninterval = 0\n";
+
+	auto config = parse_config_string(ss.str(), "bench");
+	for (auto& block : config.blocks)
+		block->initialize();
+
+	std::atomic<bool> stop = false;
+	std::vector<std::thread> updaters;
+	for (std::size_t i = 0; i < updater_count; i++)
+	{
+		updaters.emplace_back([&, i]() {
+			for (uint64_t counter = 0; !stop; counter++)
+				for (std::size_t j = i; j < config.blocks.size(); j += updater_count)
+					config.blocks[j]->set_data("text", std::to_string(counter));
+		});
+	}
+
+	std::string out;
+	harness.run("print/frame/100/concurrent_updates", [&]() {
+		out.clear();
+		render_frame(config.blocks, out);
+		do_not_optimize(out);
+	});
+
+	stop = true;
+	for (auto& updater : updaters)
+		updater.join();
+	for (auto& block : config.blocks)
+		block->stop();
+}
+
+static void bench_click(bench::Harness& harness)
+{
+	harness.run("click/parse_click_event", []() {
+		ClickEvent event;
+		do_not_optimize(parse_click_event(s_click_fixture, event));
+		do_not_optimize(event);
+	});
+}
+
+static void bench_proc(bench::Harness& harness)
+{
+	auto parse = [](std::string_view data) {
+		Sampler::Snapshot snapshot;
+		snapshot.data = data;
+		Sampler::parse(snapshot);
+		do_not_optimize(snapshot.lines.data());
+	};
+
+	harness.run("proc/parse/stat",		[&]() { parse(s_stat_fixture);		});
+	harness.run("proc/scan/meminfo",	[&]() {
+		uint64_t values[meminfo::KeyCount] {};
+		do_not_optimize(meminfo::scan(s_meminfo_fixture, (1u << meminfo::MemTotal) | (1u << meminfo::MemAvailable), values));
+	});
+	harness.run("proc/parse/pressure",	[&]() { parse(s_pressure_fixture);	});
+
+	// Live files, every call asks for a newer snapshot so the file is read again
+	for (auto [name, source] : {
+		std::pair { "proc/sample/stat",		Sampler::Source::Stat		},
+		std::pair { "proc/sample/meminfo",	Sampler::Source::Meminfo	},
+		std::pair { "proc/sample/loadavg",	Sampler::Source::Loadavg	},
+	})
+	{
+		auto tp = Block::time_point::clock::now();
+		harness.run(name, [&]() {
+			tp += std::chrono::nanoseconds(1);
+			do_not_optimize(Sampler::get(source, tp));
+		});
+	}
+}
+
+// Battery and temperature blocks read files of src/bench/fixture, found relative to this
+// source file. Each operation is a whole update: the file is read and parsed.
+static void bench_sysfs(bench::Harness& harness)
+{
+	auto root = std::filesystem::path(__FILE__).parent_path() / "fixture";
+	if (!std::filesystem::exists(root / "sys"))
+	{
+		std::cerr << "Fixtures not found in '" << root.string() << "', skipping sys benchmarks" << std::endl;
+		return;
+	}
+
+	// Paths are resolved against the root when the config is parsed
+	set_system_root(root.string());
+	auto config = parse_config_string(
+		"order = [\"battery\", \"temperature\"]\n"
+		"[battery]\n"
+		"type = \"internal/battery\"\n"
+		"format = \"%status% %value%%\"\n"
+		"[temperature]\n"
+		"type = \"internal/temperature\"\n"
+		"format = \"%value% °C\"\n",
+		"bench");
+	set_system_root("");
+
+	auto tp = Block::time_point::clock::now();
+	auto* battery		= dynamic_cast<BatteryBlock*>(config.blocks[0].get());
+	auto* temperature	= dynamic_cast<TemperatureBlock*>(config.blocks[1].get());
+
+	harness.run("sys/update/battery",		[&]() { do_not_optimize(battery->custom_update(tp));		});
+	harness.run("sys/update/temperature",	[&]() { do_not_optimize(temperature->custom_update(tp));	});
+}
+
+static void bench_stats(bench::Harness& harness)
+{
+	Histogram histogram;
+	uint64_t ns = 0;
+	harness.run("stats/histogram_record", [&]() {
+		histogram.record(Histogram::duration(ns++ & 0xFFFFF));
+	});
+
+	TimedMutex mutex(histogram);
+	harness.run("stats/timed_mutex_lock", [&]() {
+		std::scoped_lock _(mutex);
+	});
+
+	harness.run("stats/histogram_summarize", [&]() {
+		do_not_optimize(histogram.summarize());
+	});
+}
+
+// Work done by main() at startup. first_frame is config parsing and the frame with
+// 'format-loading' texts, written before blocks are initialized. initialize is the time
+// from starting the blocks until all of them have finished their first update.
+static void bench_startup(bench::Harness& harness)
+{
+	std::string content = make_config(20);
+
+	auto start = std::chrono::steady_clock::now();
+	auto config = parse_config_string(content, "bench");
+	std::string frame;
+	frame = protocol_header();
+	render_frame(config.blocks, frame);
+	do_not_optimize(frame);
+	harness.report("startup/first_frame/20", std::chrono::steady_clock::now() - start);
+
+	if (harness.is_enabled("startup/initialize/20"))
+	{
+		start = std::chrono::steady_clock::now();
+		for (auto& block : config.blocks)
+			block->initialize();
+		for (auto& block : config.blocks)
+			while (!block->is_ready())
+				std::this_thread::yield();
+		harness.report("startup/initialize/20", std::chrono::steady_clock::now() - start);
+
+		for (auto& block : config.blocks)
+			block->stop();
+	}
+
+	harness.run("startup/parse_config/20", [&]() {
+		do_not_optimize(parse_config_string(content, "bench"));
+	});
+}
+
+int main(int argc, char** argv)
+{
+	bench::Harness harness(argc, argv);
+
+	bench_common(harness);
+	bench_print(harness);
+	bench_concurrent(harness);
+	bench_click(harness);
+	bench_proc(harness);
+	bench_sysfs(harness);
+	bench_stats(harness);
+	bench_startup(harness);
+
+	return harness.finish();
+}
\ No newline at end of file
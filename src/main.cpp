@@ -1,11 +1,35 @@
+#include "Cache.h"
+#include "Common.h"
 #include "Config.h"
+#include "Control.h"
+#include "I3bar.h"
+#include "PulseAudio.h"
 
-#include <nlohmann/json.hpp>
-
+#include <algorithm>
 #include <csignal>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <poll.h>
+#include <shared_mutex>
+#include <sstream>
+#include <sys/resource.h>
 #include <thread>
+#include <unistd.h>
+
+#ifdef BSBAR_COUNT_ALLOCATIONS
+#include "bench/Allocations.h"
+#endif
+
+// Counting replaces the global operator new, so only Profile builds report allocations
+static std::optional<uint64_t> allocation_count()
+{
+#ifdef BSBAR_COUNT_ALLOCATIONS
+	return bsbar::bench::allocation_count();
+#else
+	return std::nullopt;
+#endif
+}
 
 static std::string get_home_directory(char** env)
 {
@@ -19,181 +43,714 @@ static std::string get_home_directory(char** env)
 	return "";
 }
 
-static bool parse_mouse_info(const nlohmann::json& json, bsbar::Block::MouseInfo& out)
-{
-	if (!json.contains("button") || !json["button"].is_number())
-		return false;
+// Blocks are replaced only by config reload on signal thread, which holds the mutex exclusively.
+// Every other thread must hold it shared while using blocks.
+static std::vector<std::unique_ptr<bsbar::Block>>	s_blocks;
+static std::vector<toml::table>						s_block_configs;
+static std::shared_mutex							s_blocks_mutex;
+// Blocks of s_blocks by instance name, keys are owned by the blocks
+static std::unordered_map<std::string_view, bsbar::Block*>	s_blocks_by_instance;
 
-	switch ((int)json["button"])
-	{
-		case 1: out.type = bsbar::Block::MouseType::Left;		break;
-		case 2: out.type = bsbar::Block::MouseType::Middle;		break;
-		case 3: out.type = bsbar::Block::MouseType::Right;		break;
-		case 4: out.type = bsbar::Block::MouseType::ScrollUp;	break;
-		case 5: out.type = bsbar::Block::MouseType::ScrollDown;	break;
-		default:
-			return false;
-	}
+static std::atomic<int64_t>							s_scroll_window;
 
-	if (!json.contains("relative_x") || !json["relative_x"].is_number())
-		return false;
-	out.pos[0] = json["relative_x"];
+static int											s_signal_pipe[2] = { -1, -1 };
 
-	if (!json.contains("relative_y") || !json["relative_y"].is_number())
-		return false;
-	out.pos[1] = json["relative_y"];
+// Milliseconds from start of main(), negative until reached
+struct StartupStats
+{
+	std::chrono::steady_clock::time_point	start			= std::chrono::steady_clock::now();
+	std::atomic<double>						first_frame		= -1.0;
+	std::atomic<double>						all_ready		= -1.0;
 
-	if (!json.contains("width") || !json["width"].is_number())
-		return false;
-	out.size[0] = json["width"];
+	double elapsed() const { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); }
+};
+static StartupStats									s_startup_stats;
 
-	if (!json.contains("height") || !json["height"].is_number())
-		return false;
-	out.size[1] = json["height"];
+static std::atomic<uint64_t>						s_frame_count = 0;
+static std::atomic<uint64_t>						s_wakeup_count = 0;
 
-	return true;
-}
+// Frames are written to stdout without blocking callers, see FrameWriter
+static std::unique_ptr<bsbar::FrameWriter>			s_frame_writer;
 
-static std::vector<std::unique_ptr<bsbar::Block>> s_blocks;
+// Output of the previous run is shown until blocks have updated, see FrameCache
+static std::unique_ptr<bsbar::FrameCache>			s_frame_cache;
 
 void print_blocks()
 {
 	static std::mutex print_mutex;
 
+	std::string frame;
+
 	std::scoped_lock _(print_mutex);
+	{
+		std::shared_lock __(s_blocks_mutex);
+		bsbar::render_frame(s_blocks, frame);
+	}
 
-	static bool first_bar = true;
+	s_frame_writer->submit(std::move(frame));
+	s_frame_count++;
+}
 
-	if (!first_bar)
-		std::printf(",");
+// Signals are forwarded to signal_thread, since handlers can't safely lock mutexes
+static void signal_handler(int signal)
+{
+	int saved_errno = errno;
+	unsigned char sig = signal;
+	write(s_signal_pipe[1], &sig, 1);
+	errno = saved_errno;
+}
+
+// Must be called whenever s_blocks changes, with s_blocks_mutex held exclusively
+static void index_blocks()
+{
+	s_blocks_by_instance.clear();
+	for (auto& block : s_blocks)
+		s_blocks_by_instance.emplace(block->get_instance(), block.get());
+}
+
+static void dump_stats(std::ostream& out)
+{
+	out << "startup: first frame " << s_startup_stats.first_frame << " ms";
+	out << ", all blocks ready " << s_startup_stats.all_ready << " ms" << std::endl;
+	bsbar::PulseAudioBlock::dump_stats(out);
+
+	auto output = s_frame_writer->get_stats();
+	out << "output: frames written " << output.written;
+	out << ", dropped " << output.dropped;
+	out << ", partial writes " << output.partial_writes << std::endl;
 
-	bool first_block = true;
-	std::printf("[");
+	out << "scheduler: wakeups " << s_wakeup_count << std::endl;
+	if (s_frame_cache)
+		out << "cache: writes " << s_frame_cache->get_write_count() << std::endl;
+	bsbar::dump_power_stats(out);
+
+	std::shared_lock _(s_blocks_mutex);
 	for (const auto& block : s_blocks)
+		block->dump_stats(out);
+}
+
+// Blocks may wait for external services (e.g. PulseAudio server) while initializing
+static void initialize_blocks(const std::vector<bsbar::Block*>& blocks)
+{
+	std::vector<std::thread> threads;
+	for (auto* block : blocks)
+		threads.emplace_back([block]() { block->initialize(); });
+	for (auto& thread : threads)
+		thread.join();
+}
+
+static void handle_block_signal(int signal)
+{
 	{
-		if (!first_block)
-			printf(",");
-		block->print();
-		first_block = false;
+		std::shared_lock _(s_blocks_mutex);
+		for (auto& block : s_blocks)
+		{
+			if (!block->handles_signal(signal))
+				continue;
+			block->reset_interval();
+			block->request_update(!bsbar::Block::is_paused());
+		}
 	}
-	std::printf("]\n");
-	std::fflush(stdout);
-
-	first_bar = false;
+	print_blocks();
 }
 
-static void signal_handler(int signal)
+static void dispatch_click_event(const bsbar::ClickEvent& event)
 {
-	for (auto& block : s_blocks)
-		if (block->handles_signal(signal))
+	{
+		std::shared_lock _(s_blocks_mutex);
+		if (auto it = s_blocks_by_instance.find(event.instance); it != s_blocks_by_instance.end())
+		{
+			auto* block = it->second;
+			if (bsbar::is_scroll(event))
+				block->handle_scroll(event.mouse, event.sub);
+			else
+				block->handle_click(event.mouse, event.sub);
 			block->request_update(true);
+		}
+	}
+
 	print_blocks();
 }
 
+// Reads lines from stdin with optional timeout
+class LineReader
+{
+public:
+	// Returns false on timeout or end of input. Negative timeout waits indefinitely.
+	bool read_line(std::string& out, int timeout_ms)
+	{
+		std::size_t pos;
+		while ((pos = m_buffer.find('\n')) == std::string::npos)
+		{
+			if (m_eof)
+				return false;
+
+			pollfd pfd { .fd = STDIN_FILENO, .events = POLLIN, .revents = 0 };
+			int ret = poll(&pfd, 1, timeout_ms);
+			if (ret == -1 && errno == EINTR)
+				continue;
+			if (ret <= 0)
+				return false;
+
+			char buffer[4096];
+			ssize_t nread = read(STDIN_FILENO, buffer, sizeof(buffer));
+			if (nread == -1 && errno == EINTR)
+				continue;
+			if (nread <= 0)
+				m_eof = true;
+			else
+				m_buffer.append(buffer, nread);
+		}
+
+		out = m_buffer.substr(0, pos);
+		m_buffer.erase(0, pos + 1);
+		return true;
+	}
+
+	bool eof() const { return m_eof && m_buffer.find('\n') == std::string::npos; }
+
+private:
+	std::string	m_buffer;
+	bool		m_eof = false;
+};
+
 static void handle_clicks()
 {
+	LineReader reader;
+
 	std::string line;
-	std::getline(std::cin, line);
+	reader.read_line(line, -1);
+
+	std::optional<bsbar::ClickEvent> pending;
 
 	while (true)
 	{
-		std::getline(std::cin, line);
-		std::string_view line_sv = line;
-		if (line_sv.front() == ',')
-			line_sv = line_sv.substr(1);
-
+		bsbar::ClickEvent event;
+		if (pending)
+		{
+			event = std::move(*pending);
+			pending.reset();
+		}
+		else
+		{
+			if (!reader.read_line(line, -1))
+			{
+				if (reader.eof())
+					return;
+				continue;
+			}
+			if (!bsbar::parse_click_event(line, event))
+				continue;
+		}
 
-		nlohmann::json json;
-		try {
-			json = nlohmann::json::parse(line_sv);
-		} catch(...) {
+		auto scroll_window = std::chrono::milliseconds(s_scroll_window.load());
+		if (!bsbar::is_scroll(event) || scroll_window.count() == 0)
+		{
+			dispatch_click_event(event);
 			continue;
 		}
 
-		if (!json.contains("name") || !json.contains("instance"))
-			continue;
-		if (!json["name"].is_string() || !json["instance"].is_string())
+		// First step of a burst is handled right away. Scroll events on the same block that
+		// follow within the window are merged into one event with net step count, e.g. 3 up
+		// and 1 down becomes 2 up, which is dispatched when the window closes.
+		dispatch_click_event(event);
+		int steps = 0;
+
+		auto deadline = std::chrono::steady_clock::now() + scroll_window;
+		while (true)
+		{
+			auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+			if (remaining.count() <= 0 || !reader.read_line(line, remaining.count()))
+				break;
+
+			bsbar::ClickEvent next;
+			if (!bsbar::parse_click_event(line, next))
+				continue;
+
+			if (!bsbar::is_scroll(next) || next.instance != event.instance || next.sub != event.sub)
+			{
+				pending = std::move(next);
+				break;
+			}
+
+			steps += next.mouse.type == bsbar::Block::MouseType::ScrollUp ? 1 : -1;
+		}
+
+		if (steps == 0)
 			continue;
 
-		std::string name		= json["name"];
-		std::string instance	= json["instance"];
-		std::string sub;
+		event.mouse.type	= steps > 0 ? bsbar::Block::MouseType::ScrollUp : bsbar::Block::MouseType::ScrollDown;
+		event.mouse.count	= std::abs(steps);
+		dispatch_click_event(event);
+	}
+}
+
+// Blocks whose instance name and module table are unchanged keep running as is.
+// Only added and changed blocks are created and removed ones are stopped.
+static void reload_config(const std::string& config_path)
+{
+	auto content = bsbar::read_config(config_path);
+	if (!content)
+	{
+		std::cerr << "Could not open config file '" << config_path << "', keeping current configuration" << std::endl;
+		return;
+	}
+
+	if (!bsbar::validate_config(*content, config_path))
+	{
+		std::cerr << "Errors in config file '" << config_path << "', keeping current configuration" << std::endl;
+		return;
+	}
+
+	auto config = bsbar::parse_config_string(*content, config_path);
 
-		if (auto pos = instance.find('.'); pos != std::string::npos)
+	// s_blocks is only modified by this thread, so it can be read without lock
+	std::vector<std::optional<std::size_t>> reused(config.blocks.size());
+	std::vector<bool> taken(s_blocks.size(), false);
+	for (std::size_t i = 0; i < config.blocks.size(); i++)
+	{
+		for (std::size_t j = 0; j < s_blocks.size(); j++)
 		{
-			sub			= instance.substr(pos + 1);
-			instance	= instance.substr(0, pos);
+			if (taken[j] || s_blocks[j]->get_instance() != config.blocks[i]->get_instance())
+				continue;
+			if (s_block_configs[j] != config.block_configs[i])
+				continue;
+			reused[i] = j;
+			taken[j] = true;
+			break;
 		}
+	}
 
-		bsbar::Block::MouseInfo mouse;
-		if (!parse_mouse_info(json, mouse))
-			continue;
+	// New blocks are started before the swap, so they have text once shown
+	std::vector<bsbar::Block*> started;
+	for (std::size_t i = 0; i < config.blocks.size(); i++)
+		if (!reused[i])
+			started.push_back(config.blocks[i].get());
+	initialize_blocks(started);
 
-		for (auto& block : s_blocks)
+	std::vector<std::unique_ptr<bsbar::Block>> unused;
+	{
+		std::unique_lock _(s_blocks_mutex);
+
+		for (std::size_t i = 0; i < config.blocks.size(); i++)
+			if (reused[i])
+				std::swap(config.blocks[i], s_blocks[*reused[i]]);
+
+		// Left in s_blocks are removed blocks and never initialized duplicates of reused blocks
+		unused = std::move(s_blocks);
+		s_blocks = std::move(config.blocks);
+		s_block_configs = std::move(config.block_configs);
+		s_scroll_window = config.scroll_window;
+		index_blocks();
+	}
+
+	// Blocks pick up the new profile on the next tick without restarting
+	bsbar::set_power_config(std::move(config.power_config));
+
+	for (auto& block : unused)
+		block->stop();
+
+	std::cerr << "Config reloaded, " << s_blocks.size() - started.size() << " blocks kept, " << started.size() << " started, ";
+	std::cerr << std::count(taken.begin(), taken.end(), false) << " stopped" << std::endl;
+
+	bsbar::Block::request_frame();
+}
+
+// Updates are asynchronous, blocks request a frame once they are done. Commands of
+// one write therefore end up in as few frames as possible.
+static std::string handle_control_command(std::string_view line)
+{
+	auto command = bsbar::parse_control_command(line);
+	if (!command)
+		return "invalid command '" + std::string(line) + "'. valid commands are 'update <instance>' and 'set <instance> <key> <data>'";
+
+	std::shared_lock _(s_blocks_mutex);
+
+	auto it = s_blocks_by_instance.find(command->instance);
+	if (it == s_blocks_by_instance.end())
+		return "unknown block '" + std::string(command->instance) + '\'';
+
+	switch (command->type)
+	{
+		case bsbar::ControlCommand::Type::Update:
+			it->second->reset_interval();
+			it->second->request_async_update();
+			break;
+		case bsbar::ControlCommand::Type::Set:
+			if (!it->second->set_data(command->key, command->data))
+				return "block '" + std::string(command->instance) + "' does not accept " + std::string(command->key) + " '" + std::string(command->data) + '\'';
+			break;
+	}
+
+	return {};
+}
+
+static void signal_thread(std::string config_path)
+{
+	bsbar::ConfigWatcher watcher(config_path);
+
+	pollfd fds[2] {};
+	fds[0].fd = s_signal_pipe[0];
+	fds[0].events = POLLIN;
+	fds[1].fd = watcher.get_fd();
+	fds[1].events = POLLIN;
+
+	while (true)
+	{
+		if (poll(fds, 2, -1) == -1)
 		{
-			if (block->get_instance() == instance)
+			if (errno == EINTR)
+				continue;
+			std::cerr << "poll()\n  " << strerror(errno) << std::endl;
+			return;
+		}
+
+		bool reload = false;
+
+		if (fds[0].revents & POLLIN)
+		{
+			unsigned char signals[64];
+			ssize_t nread = read(s_signal_pipe[0], signals, sizeof(signals));
+			for (ssize_t i = 0; i < nread; i++)
 			{
-				switch (mouse.type)
-				{
-					case bsbar::Block::MouseType::Left:
-					case bsbar::Block::MouseType::Middle:
-					case bsbar::Block::MouseType::Right:
-						block->handle_click(mouse, sub);
-						break;
-					case bsbar::Block::MouseType::ScrollDown:
-					case bsbar::Block::MouseType::ScrollUp:
-						block->handle_scroll(mouse, sub);
-						break;
-				}
-				block->request_update(true);
-				break;
+				if (signals[i] == SIGHUP)
+					reload = true;
+				else if (signals[i] == SIGUSR1)
+					dump_stats(std::cerr);
+				else if (signals[i] == SIGTSTP)
+					bsbar::Block::set_paused(true);
+				else if (signals[i] == SIGCONT)
+					bsbar::Block::set_paused(false);
+				else
+					handle_block_signal(signals[i]);
 			}
 		}
 
+		if ((fds[1].revents & POLLIN) && watcher.read_events())
+		{
+			// Editors may save in multiple steps, reload once events have settled
+			pollfd pfd = fds[1];
+			while (poll(&pfd, 1, 100) > 0)
+				watcher.read_events();
+			reload = true;
+		}
+
+		if (reload)
+			reload_config(config_path);
+	}
+}
+
+// Used by config reload, see bsbar::validate_config(). Exits with 1 on any error.
+static int check_config(std::string_view path, std::string_view source_path)
+{
+	std::string content;
+	if (path == "-")
+	{
+		std::stringstream ss;
+		ss << std::cin.rdbuf();
+		content = ss.str();
+	}
+	else if (auto result = bsbar::read_config(std::string(path)))
+		content = std::move(*result);
+	else
+	{
+		std::cerr << "Could not open config file '" << path << '\'' << std::endl;
+		return 1;
+	}
+
+	bsbar::parse_config_string(content, source_path);
+	return 0;
+}
+
+using time_point = bsbar::Block::time_point;
+
+// Shows the output of the previous run on blocks found in the cache, by instance name and type
+static void restore_frame_cache(const std::optional<std::string>& stale_color)
+{
+	for (const auto& entry : s_frame_cache->load())
+	{
+		auto it = s_blocks_by_instance.find(entry.instance);
+		if (it != s_blocks_by_instance.end() && it->second->get_name() == entry.type)
+			it->second->restore_cache_entry(entry, stale_color);
+	}
+}
+
+// Cache is written once every block has been updated and then at most every FrameCache::store_interval
+static void store_frame_cache()
+{
+	if (!s_frame_cache || s_startup_stats.all_ready < 0.0)
+		return;
+
+	auto now = std::chrono::steady_clock::now();
+	if (!s_frame_cache->is_store_due(now))
+		return;
+
+	std::vector<bsbar::FrameCache::Entry> entries;
+	{
+		std::shared_lock _(s_blocks_mutex);
+		for (const auto& block : s_blocks)
+			if (bsbar::FrameCache::Entry entry; block->get_cache_entry(entry))
+				entries.push_back(std::move(entry));
+	}
+	s_frame_cache->store(entries, now);
+}
+
+// Runs scheduler until `until`, returns number of block updates. In simulation every updated
+// block is waited for and time jumps directly to the next deadline.
+static uint64_t run_scheduler(time_point until)
+{
+	uint64_t updates = 0;
+
+	time_point tp = bsbar::Clock::now();
+	while (tp < until)
+	{
+		// After i3bar shows the bar again every block is refreshed once, whether due or not
+		bool catch_up = bsbar::Block::wait_while_paused();
+		if (catch_up)
+			tp = bsbar::Clock::now();
+
+		s_wakeup_count++;
+		bsbar::poll_power_state(tp);
+
+		time_point next = time_point::max();
+
+		{
+			std::shared_lock _(s_blocks_mutex);
+
+			// Only blocks due at this time point are updated, others keep their previous text
+			std::vector<bsbar::Block*> updated;
+			for (auto& block : s_blocks)
+			{
+				bool due = block->update_clock_tick(tp);
+				if (!due && catch_up)
+					block->request_update(false, tp);
+				if (due || catch_up)
+					updated.push_back(block.get());
+			}
+			updates += updated.size();
+
+			for (auto* block : updated)
+			{
+				if (bsbar::Clock::is_simulated())
+					block->block_until_updated(tp);
+				else
+					block->wait_if_needed(tp);
+			}
+
+			for (auto& block : s_blocks)
+				next = std::min(next, block->get_next_update());
+		}
+
 		print_blocks();
+
+		if (s_startup_stats.all_ready < 0.0)
+		{
+			std::shared_lock _(s_blocks_mutex);
+			if (std::all_of(s_blocks.begin(), s_blocks.end(), [](const auto& block) { return block->is_ready(); }))
+				s_startup_stats.all_ready = s_startup_stats.elapsed();
+		}
+
+		store_frame_cache();
+
+		if (bsbar::Clock::is_simulated())
+		{
+			// Time does not pass while handling requests, e.g. an adaptive interval dropping back
+			if (bsbar::Block::wait_frame_request_until(bsbar::Clock::now()))
+				continue;
+			tp = std::min(next, until);
+			bsbar::Clock::advance(tp);
+			continue;
+		}
+
+		// Blocks updated outside of their schedule (e.g. PulseAudio events, config reload) request
+		// frames in between. Otherwise the deadline is used as time point so blocks render the exact
+		// boundary they woke up for. After suspend the missed deadlines are skipped.
+		if (bsbar::Block::wait_frame_request_until(next))
+			tp = bsbar::Clock::now();
+		else
+			tp = std::max(next, bsbar::Clock::now());
 	}
+
+	return updates;
+}
+
+// Accepts plain seconds or a number with suffix s, m, h or d
+static std::optional<std::chrono::seconds> parse_duration(std::string_view sv)
+{
+	int64_t multiplier = 1;
+	switch (sv.empty() ? '\0' : sv.back())
+	{
+		case 's': multiplier = 1;		sv.remove_suffix(1); break;
+		case 'm': multiplier = 60;		sv.remove_suffix(1); break;
+		case 'h': multiplier = 3600;	sv.remove_suffix(1); break;
+		case 'd': multiplier = 86400;	sv.remove_suffix(1); break;
+	}
+
+	int64_t value;
+	if (!bsbar::string_to_value(sv, value) || value <= 0)
+		return {};
+	return std::chrono::seconds(value * multiplier);
+}
+
+static double cpu_time_seconds()
+{
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Replays `duration` of scheduling against simulated time as fast as blocks update.
+// Frames are written to stdout as usual and the report to stderr.
+static int simulate(std::chrono::seconds duration)
+{
+	std::vector<bsbar::Block*> blocks;
+	for (auto& block : s_blocks)
+		blocks.push_back(block.get());
+	initialize_blocks(blocks);
+
+	double		cpu_start		= cpu_time_seconds();
+	auto		allocs_start	= allocation_count();
+	uint64_t	frames_start	= s_frame_count;
+	uint64_t	wakeups_start	= s_wakeup_count;
+	auto		wall_start		= std::chrono::steady_clock::now();
+
+	uint64_t updates = run_scheduler(bsbar::Clock::now() + duration);
+	s_frame_writer->flush();
+
+	double		cpu		= cpu_time_seconds() - cpu_start;
+	auto		allocs_end	= allocation_count();
+	uint64_t	frames	= s_frame_count - frames_start;
+	uint64_t	wakeups	= s_wakeup_count - wakeups_start;
+	double		wall	= std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+	double		hours	= duration.count() / 3600.0;
+
+	for (auto& block : s_blocks)
+		block->stop();
+
+	std::fprintf(stderr, "simulated %.2f hours in %.3f s\n", hours, wall);
+	std::fprintf(stderr, "  %-12s %14s %16s\n", "", "total", "per hour");
+	std::fprintf(stderr, "  %-12s %14lu %16.1f\n", "updates",		(unsigned long)updates,	updates / hours);
+	std::fprintf(stderr, "  %-12s %14lu %16.1f\n", "frames",		(unsigned long)frames,	frames / hours);
+	std::fprintf(stderr, "  %-12s %14lu %16.1f\n", "wakeups",		(unsigned long)wakeups,	wakeups / hours);
+	std::fprintf(stderr, "  %-12s %14.3f %16.4f\n", "cpu time (s)",	cpu,					cpu / hours);
+	if (allocs_start && allocs_end)
+	{
+		uint64_t allocs = *allocs_end - *allocs_start;
+		std::fprintf(stderr, "  %-12s %14lu %16.1f\n", "allocations",	(unsigned long)allocs,	allocs / hours);
+	}
+
+	return 0;
 }
 
 int main(int argc, char** argv, char** env)
 {
 	std::string config_path = get_home_directory(env) + "/.config/bsbar/config.toml";
-	
-	if (argc == 2)
-		config_path = argv[1];
-	if (argc > 2)
-		return 1;
+
+	if (argc >= 2 && std::string_view(argv[1]) == "--check-config")
+	{
+		std::string_view path = argc >= 3 ? argv[2] : config_path;
+		return check_config(path, argc >= 4 ? argv[3] : path);
+	}
+
+	std::optional<std::chrono::seconds> simulate_duration;
+
+	bool has_config_path = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view arg = argv[i];
+		if (arg == "--simulate" && i + 1 < argc)
+		{
+			simulate_duration = parse_duration(argv[++i]);
+			if (!simulate_duration)
+			{
+				std::cerr << "invalid duration '" << argv[i] << "' for --simulate, e.g. 3600, 90m, 24h" << std::endl;
+				return 1;
+			}
+		}
+		else if (arg == "--root" && i + 1 < argc)
+			bsbar::set_system_root(argv[++i]);
+		else if (!has_config_path && !arg.starts_with("--"))
+		{
+			config_path = arg;
+			has_config_path = true;
+		}
+		else
+		{
+			std::cerr << "usage: " << argv[0] << " [--simulate <duration> [--root <dir>]] [config]" << std::endl;
+			std::cerr << "       " << argv[0] << " --check-config [config]" << std::endl;
+			return 1;
+		}
+	}
+
+	// Simulation starts from a fixed time point so runs are reproducible
+	if (simulate_duration)
+		bsbar::Clock::start_simulation(time_point(std::chrono::seconds(1704067200)));
 
 	auto config = bsbar::parse_config(config_path);
-	s_blocks = std::move(config.blocks);
+	s_blocks		= std::move(config.blocks);
+	s_block_configs	= std::move(config.block_configs);
+	s_scroll_window	= config.scroll_window;
+	index_blocks();
+	bsbar::set_power_config(std::move(config.power_config));
 
-	for (auto& block : s_blocks)
-		block->initialize();
+	s_frame_writer = std::make_unique<bsbar::FrameWriter>(STDOUT_FILENO, bsbar::protocol_header());
+
+	if (simulate_duration)
+		return simulate(*simulate_duration);
+
+	if (auto path = bsbar::FrameCache::default_path(); config.cache && !path.empty())
+	{
+		s_frame_cache = std::make_unique<bsbar::FrameCache>(path);
+		restore_frame_cache(config.stale_color);
+	}
+
+	if (pipe2(s_signal_pipe, O_CLOEXEC | O_NONBLOCK) == -1)
+	{
+		std::cerr << "pipe2()\n  " << strerror(errno) << std::endl;
+		return 1;
+	}
 
 	// Assing signal handler for all signals between SIGRTMIN and SIGRTMAX
 	for (int sig = SIGRTMIN; sig <= SIGRTMAX; sig++)
 		std::signal(sig, signal_handler);
 
-	std::thread t = std::thread(handle_clicks);
+	// Runtime statistics are written to stderr on SIGUSR1
+	std::signal(SIGUSR1, signal_handler);
 
-	std::printf("{\"version\":1,\"click_events\":true}\n[\n");
+	// Config is reloaded on SIGHUP and when the config file changes
+	std::signal(SIGHUP, signal_handler);
 
-	using time_point = bsbar::Block::time_point;
+	// Work is paused while i3bar is hidden, see stop_signal and cont_signal in the header
+	std::signal(SIGTSTP, signal_handler);
+	std::signal(SIGCONT, signal_handler);
 
-	time_point tp = time_point::clock::now();
-	while (true)
-	{
-		for (auto& block : s_blocks)
-			block->update_clock_tick(tp);
+	// Header and a frame of 'format-loading' texts are written before any block is ready
+	print_blocks();
+	s_startup_stats.first_frame = s_startup_stats.elapsed();
 
-		for (auto& block : s_blocks)
-			block->wait_if_needed(tp);
+	// Blocks request a frame once their first update is done. Signals and reloads are
+	// handled after initialization, signals received meanwhile are kept in the pipe.
+	std::vector<bsbar::Block*> blocks;
+	for (auto& block : s_blocks)
+		blocks.push_back(block.get());
+	std::thread([blocks, config_path]() {
+		initialize_blocks(blocks);
+		signal_thread(config_path);
+	}).detach();
 
-		print_blocks();
+	std::thread t = std::thread(handle_clicks);
 
-		tp = time_point::clock::now();
-		tp = ceil<std::chrono::seconds>(tp);
-		std::this_thread::sleep_until(tp);
+	// Blocks can be updated by name through $XDG_RUNTIME_DIR/bsbar.sock
+	if (auto path = bsbar::ControlSocket::default_path(); !path.empty())
+	{
+		std::thread([path]() {
+			bsbar::ControlSocket socket(path);
+			if (socket.is_open())
+				socket.run(handle_control_command);
+		}).detach();
 	}
-	
+
+	run_scheduler(time_point::max());
+
 	return 0;
 }
\ No newline at end of file